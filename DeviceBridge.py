@@ -1,16 +1,22 @@
 #!/usr/bin/python
 # -*- coding: UTF-8 -*-
 from abc import ABCMeta, abstractmethod
+import os
+import platform
+import shutil
+import socket
 import subprocess
 import sys
 import re
+import shlex
 from typing import List
 
 
-def run_cmd(args: List[str]) -> str:
+def run_cmd(args: List[str], merge_stderr: bool = False) -> str:
     try:
-        return subprocess.check_output(args, shell=False).decode('utf-8')
-    except subprocess.CalledProcessError:
+        stderr = subprocess.STDOUT if merge_stderr else None
+        return subprocess.check_output(args, shell=False, stderr=stderr).decode('utf-8')
+    except (subprocess.CalledProcessError, OSError):
         print(f'cmd run failed: {args}')
         sys.exit(-1)
 
@@ -41,7 +47,15 @@ class DeviceBridge(metaclass=ABCMeta):
         pass
 
     @abstractmethod
-    def shell(self, args: List[str]) -> None:
+    def shell(self, args: List[str]) -> str:
+        pass
+
+    @abstractmethod
+    def work_dir(self) -> str:
+        pass
+
+    @abstractmethod
+    def perf_stat(self) -> List[str]:
         pass
 
 
@@ -85,16 +99,72 @@ class Adb(DeviceBridge):
         ret = run_cmd(cmd)
         print(ret)
 
-    def shell(self, args: List[str]) -> None:
+    def shell(self, args: List[str]) -> str:
         if not self.device:
             raise RuntimeError('device is not set')
-        cmd = ['adb', '-s', self.device, 'shell'] + args
+        # adb joins the arguments into one command line for the device shell, quote each to keep it one word
+        cmd = ['adb', '-s', self.device, 'shell'] + [shlex.quote(arg) for arg in args]
         ret = run_cmd(cmd)
         print(ret)
+        return ret
+
+    def work_dir(self) -> str:
+        return '/data/local/tmp'
+
+    def perf_stat(self) -> List[str]:
+        return ['simpleperf', 'stat']
+
+
+class Local(DeviceBridge):
+    def __init__(self, directory: str = 'output'):
+        self.device = ''
+        self.directory = os.path.abspath(directory)
+
+    def version(self) -> None:
+        print(platform.platform())
+
+    def devices(self) -> List[str]:
+        return [socket.gethostname()]
+
+    def set_device(self, device: str) -> None:
+        self.device = device
+
+    def get_device(self) -> str:
+        return self.device
+
+    def push(self, source: str, destination: str) -> None:
+        if not self.device or not isinstance(source, str) or not isinstance(destination, str):
+            raise RuntimeError('device is not set')
+        os.makedirs(destination, exist_ok=True)
+        target = os.path.join(destination, os.path.basename(source))
+        if os.path.abspath(source) != os.path.abspath(target):
+            shutil.copy(source, target)
+
+    def pull(self, source: str, destination: str = '.') -> None:
+        if not self.device or not isinstance(source, str):
+            raise RuntimeError('device is not set')
+        target = os.path.join(destination, os.path.basename(source))
+        if os.path.abspath(source) != os.path.abspath(target):
+            shutil.copy(source, target)
+
+    def shell(self, args: List[str]) -> str:
+        if not self.device:
+            raise RuntimeError('device is not set')
+        ret = run_cmd(args, merge_stderr=True)
+        print(ret)
+        return ret
+
+    def work_dir(self) -> str:
+        return self.directory
+
+    def perf_stat(self) -> List[str]:
+        return ['perf', 'stat']
 
 
 class DeviceBridgeFactory(object):
     @staticmethod
-    def create_device_bridge() -> DeviceBridge:
+    def create_device_bridge(platform_name: str = 'Android') -> DeviceBridge:
+        if platform_name == 'Linux':
+            return Local()
         return Adb()
 
@@ -0,0 +1,104 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    /**
+     * @brief Get the process wide thread pool, sized to the hardware concurrency on first use
+     *
+     * @return ThreadPool& The thread pool
+     */
+    static ThreadPool &GetInstance();
+
+    /**
+     * @brief Restart the pool with a new number of threads (including the calling thread)
+     *
+     * @param threadNum The number of threads, values below 1 are clamped to 1
+     */
+    void SetThreadNum(int threadNum);
+
+    int GetThreadNum() const { return m_threadNum; }
+
+    /**
+     * @brief Bind the threads to the first nodeNum NUMA nodes, thread id runs on node id * nodeNum / threadNum, so
+     * the contiguous chunks of ParallelFor map to contiguous nodes and the calling thread stays on node 0.
+     * nodeNum is clamped to the nodes of GetNumaNodes(), 0 leaves the threads unbound
+     *
+     * @param nodeNum The number of nodes
+     */
+    void SetNumaNodeNum(int nodeNum);
+
+    /**
+     * @brief Run one thread per core, thread id bound to cores[id] and the calling thread to cores[0]. ParallelFor
+     * then splits its range in proportion to the capacity of each core, so little cores get less work
+     *
+     * @param cores The cpus, fastest first, an empty list unbinds the threads
+     */
+    void SetCores(const std::vector<int> &cores);
+
+    /**
+     * @brief Get the number of equal work units ParallelFor needs to give every thread its share, the total
+     * capacity over the smallest one. equals GetThreadNum() unless the cores are heterogeneous
+     */
+    int GetWorkUnits() const;
+
+    /**
+     * @brief Get the number of nodes the threads are bound to, 1 for unbound threads
+     */
+    int GetNumaNodeNum() const { return std::max(m_numaNodeNum, 1); }
+
+    /**
+     * @brief Get the node index in [0, GetNumaNodeNum()) the calling thread is bound to, 0 for unbound threads
+     */
+    static int GetCurrentNode();
+
+    /**
+     * @brief Split [begin, end) into at most GetThreadNum() contiguous chunks and run func(chunkBegin, chunkEnd)
+     * on each of them, chunk sizes follow the core capacities set by SetCores and the calling thread takes the first
+     * chunk. Blocks until every chunk is done. Calls made from
+     * inside a running chunk execute serially on the calling thread.
+     *
+     * @param begin The first index
+     * @param end The index past the last one
+     * @param func The function to run on each chunk
+     */
+    void ParallelFor(int begin, int end, const std::function<void(int, int)> &func);
+
+private:
+    ThreadPool();
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void Start(int threadNum);
+    void Stop();
+    void WorkerLoop(int id, unsigned long seen);
+    void RunTask(int id);
+
+private:
+    int m_threadNum = 1;
+    int m_numaNodeNum = 0;
+    std::vector<int> m_cores;
+    std::vector<long> m_weightPrefix;
+    std::vector<std::thread> m_workers;
+    std::mutex m_callMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_startCv;
+    std::condition_variable m_doneCv;
+    const std::function<void(int, int)> *m_func = nullptr;
+    int m_begin = 0;
+    int m_end = 0;
+    int m_taskNum = 0;
+    int m_pending = 0;
+    unsigned long m_generation = 0;
+    bool m_stop = false;
+};
+
+#endif  // THREAD_POOL_H
@@ -0,0 +1,133 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <cstddef>
+#include <utility>
+
+constexpr size_t CACHE_LINE_BYTES = 64;
+constexpr size_t HUGE_PAGE_BYTES = 2UL * 1024 * 1024;
+
+enum class HugePageMode {
+    OFF = 0,     /**< Regular 4 KiB pages */
+    THP = 1,     /**< Transparent huge pages requested with madvise(MADV_HUGEPAGE) [default] */
+    HUGETLB = 2, /**< Reserved huge pages from mmap(MAP_HUGETLB), THP when none are available */
+};
+
+enum class AllocInit {
+    ZERO = 0,      /**< Zeroed by the allocating thread [default] */
+    UNTOUCHED = 1, /**< Zero pages nobody touched yet, for buffers placed by first touch such as ParallelFirstTouch */
+};
+
+/**
+ * @brief Set how AlignedAlloc backs allocations of at least HUGE_PAGE_BYTES, smaller ones always use the heap
+ */
+void SetHugePageMode(HugePageMode mode);
+
+HugePageMode GetHugePageMode();
+
+/**
+ * @brief Parse "off", "thp" or "hugetlb"
+ *
+ * @return true if name is one of them
+ */
+bool ParseHugePageMode(const char *name, HugePageMode &mode);
+
+/**
+ * @brief Allocate zeroed memory aligned to CACHE_LINE_BYTES, large allocations are mapped on 2 MiB boundaries
+ * and backed by huge pages according to the huge page mode
+ *
+ * @param bytes The size in bytes
+ * @param init AllocInit::UNTOUCHED maps fresh pages instead of zeroing heap memory, only the page holding the
+ * allocation header is touched by the calling thread
+ * @return void* The memory, nullptr if it could not be allocated
+ */
+void *AlignedAlloc(size_t bytes, AllocInit init = AllocInit::ZERO);
+
+/**
+ * @brief Free memory from AlignedAlloc, nullptr is ignored
+ */
+void AlignedFree(void *ptr);
+
+/**
+ * @brief Map zeroed pages of their own for bytes rounded up to the page size, whatever the huge page mode, so that
+ * page granular calls such as mbind on the range touch nothing else. THP is requested unless the mode is off
+ *
+ * @return void* The page aligned memory, nullptr if it could not be mapped
+ */
+void *PageAlloc(size_t bytes);
+
+/**
+ * @brief Unmap memory from PageAlloc of the same size, nullptr is ignored
+ */
+void PageFree(void *ptr, size_t bytes);
+
+/**
+ * owning, move only array of n zeroed T from AlignedAlloc
+ */
+template <typename T>
+class Buffer {
+public:
+    Buffer() = default;
+    explicit Buffer(size_t n, AllocInit init = AllocInit::ZERO)
+        : m_data(static_cast<T *>(AlignedAlloc(n * sizeof(T), init))), m_size(m_data ? n : 0)
+    {}
+    Buffer(Buffer &&other) noexcept { Swap(other); }
+    Buffer &operator=(Buffer &&other) noexcept
+    {
+        Swap(other);
+        return *this;
+    }
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    ~Buffer() { AlignedFree(m_data); }
+
+    T *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    T &operator[](size_t i) const { return m_data[i]; }
+
+private:
+    void Swap(Buffer &other)
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+    }
+
+private:
+    T *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+/**
+ * owning, move only array of n zeroed T on pages of its own from PageAlloc
+ */
+template <typename T>
+class PageBuffer {
+public:
+    PageBuffer() = default;
+    explicit PageBuffer(size_t n) : m_data(static_cast<T *>(PageAlloc(n * sizeof(T)))), m_size(m_data ? n : 0) {}
+    PageBuffer(PageBuffer &&other) noexcept { Swap(other); }
+    PageBuffer &operator=(PageBuffer &&other) noexcept
+    {
+        Swap(other);
+        return *this;
+    }
+    PageBuffer(const PageBuffer &) = delete;
+    PageBuffer &operator=(const PageBuffer &) = delete;
+    ~PageBuffer() { PageFree(m_data, m_size * sizeof(T)); }
+
+    T *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    void Swap(PageBuffer &other)
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+    }
+
+private:
+    T *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+#endif  // ALLOCATOR_H
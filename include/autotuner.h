@@ -0,0 +1,108 @@
+#ifndef AUTOTUNER_H
+#define AUTOTUNER_H
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "gemm_packed.h"
+
+#ifndef DEFAULT_TUNING_FILE
+#define DEFAULT_TUNING_FILE "gemm_tuning.txt"
+#endif  // DEFAULT_TUNING_FILE
+
+class Autotuner {
+public:
+    static Autotuner &GetInstance();
+
+    /**
+     * @brief Load the tuned parameters of this cpu model from a tuning file, entries of other cpu models are kept
+     * aside so that Save writes them back
+     *
+     * @param path The tuning file
+     * @return true if the file was read
+     */
+    bool Load(const std::string &path);
+
+    /**
+     * @brief Write every entry to a tuning file
+     *
+     * @param path The tuning file
+     * @return true if the file was written
+     */
+    bool Save(const std::string &path) const;
+
+    /**
+     * @brief Get the tuned parameters for a shape, no search is done here. Falls back to the nearest tuned
+     * shape bucket with the same dtype and thread number, and to the default parameters if there is none
+     *
+     * @return PackParams The parameters for the packed path
+     */
+    PackParams Lookup(int m, int n, int k) const;
+
+    /**
+     * @brief Get the GFLOPS measured while tuning the shape bucket of m, n, k
+     *
+     * @return double The measured GFLOPS, 0 if the bucket was not tuned
+     */
+    double LookupGflops(int m, int n, int k) const;
+
+    /**
+     * @brief Get the software prefetch distance of a kernel outside the packed path. every kernel counts the
+     * distance in its own k steps, so each keeps the distance tuned for it. Falls back like Lookup, and to the
+     * default distance if the kernel was not tuned
+     *
+     * @param kernel The registered kernel name
+     * @return int Prefetch distance in k steps of the kernel, 0 disables prefetching
+     */
+    int LookupPrefetch(const std::string &kernel, int m, int n, int k) const;
+
+    /**
+     * @brief Override the software prefetch distance Lookup and LookupPrefetch return for every shape and kernel,
+     * for benchmarking
+     *
+     * @param distance Prefetch distance in k steps, 0 disables prefetching, -1 restores the tuned distance
+     */
+    void SetPrefetchDistance(int distance) { m_prefetchDistance = distance; }
+
+    /**
+     * @brief Search block sizes, register tile, unroll factor, loop order and prefetch distance for a shape by
+     * timing the packed path on random data, one dimension at a time until no dimension improves, then the
+     * prefetch distance of every other kernel that prefetches, and remember the winners
+     *
+     * @return PackParams The fastest parameters found
+     */
+    PackParams Tune(int m, int n, int k);
+
+    const std::string &GetCpuModel() const { return m_cpuModel; }
+
+private:
+    Autotuner();
+
+    /**
+     * m, n, k bucket (ceil of log2), dtype, thread number
+     */
+    using TuningKey = std::tuple<int, int, int, std::string, int>;
+
+    struct TuningEntry {
+        PackParams params;
+        double gflops;
+        std::map<std::string, int> prefetch; /**< Prefetch distance of each kernel outside the packed path */
+    };
+
+    static TuningKey MakeKey(int m, int n, int k);
+    static bool ParseEntry(std::istringstream &stream, TuningKey &key, TuningEntry &entry);
+    const TuningEntry *FindEntry(int m, int n, int k) const;
+    PackParams LookupTuned(int m, int n, int k) const;
+    void TunePrefetch(Matrix &a, Matrix &b, Matrix &c, TuningEntry &entry);
+    static std::string ReadCpuModel();
+
+private:
+    std::string m_cpuModel;
+    std::map<TuningKey, TuningEntry> m_entries;
+    std::vector<std::string> m_foreignLines;
+    int m_prefetchDistance = -1;
+};
+
+#endif  // AUTOTUNER_H
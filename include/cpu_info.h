@@ -0,0 +1,58 @@
+#ifndef CPU_INFO_H
+#define CPU_INFO_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct NumaNode {
+    int id;                /**< Node number in /sys/devices/system/node */
+    std::vector<int> cpus; /**< Cpus of the node */
+};
+
+struct CpuCore {
+    int id;         /**< Cpu number in /sys/devices/system/cpu */
+    int capacity;   /**< Relative performance, 1024 for the fastest core */
+    long maxFreq;   /**< Maximum frequency in kHz, 0 if unknown */
+    int cluster;    /**< Cluster of cores sharing the same capacity */
+};
+
+/**
+ * @brief Get the size of the last level cache of cpu0 from sysfs, 2 MiB if sysfs has no cache entries
+ *
+ * @return size_t The size in bytes
+ */
+size_t GetLlcBytes();
+
+/**
+ * @brief Parse a sysfs cpu list such as "0-3,8-11"
+ *
+ * @return std::vector<int> The cpus in ascending order, empty if the list is malformed
+ */
+std::vector<int> ParseCpuList(const std::string &list);
+
+/**
+ * @brief Get the NUMA nodes that have cpus from sysfs, a single node 0 with every cpu when sysfs has no node entries
+ */
+const std::vector<NumaNode> &GetNumaNodes();
+
+/**
+ * @brief Get the online cores from sysfs, fastest first. the capacity comes from cpu_capacity (arm big.LITTLE),
+ * otherwise from the maximum frequency relative to the fastest core, otherwise every core gets 1024
+ */
+const std::vector<CpuCore> &GetCpuCores();
+
+/**
+ * @brief Get the capacity of a cpu, 1024 for cpus GetCpuCores() does not know
+ */
+int GetCpuCapacity(int cpu);
+
+/**
+ * @brief Select cores by policy: "big" for the cores of the highest capacity, "all" for every core fastest first,
+ * otherwise a cpu list such as "4-7"
+ *
+ * @return bool false if the policy names no online core
+ */
+bool ParseCorePolicy(const std::string &policy, std::vector<int> &cores);
+
+#endif  // CPU_INFO_H
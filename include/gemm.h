@@ -8,8 +8,15 @@
 #ifndef GEMMH
 #define GEMMH
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
+enum class MatrixOrder {
+    ROW_MAJOR = 0, /**< Element (i, j) at i * w + j */
+    COL_MAJOR = 1, /**< Element (i, j) at j * h + i, also a row major buffer of the transpose */
+};
+
 class Matrix {
 public:
     /**
@@ -18,19 +25,77 @@ public:
      * @param data The data for the matrix
      * @param h The height of the matrix
      * @param w The width of the matrix
+     * @param order The storage order of data
+     */
+    Matrix(std::vector<float> &data, int h, int w, MatrixOrder order = MatrixOrder::ROW_MAJOR)
+        : data(data.data()), h(h), w(w), order(order)
+    {}
+
+    /**
+     * @brief Construct a Matrix view of memory owned elsewhere
+     *
+     * @param data The data for the matrix, h * w floats
+     * @param h The height of the matrix
+     * @param w The width of the matrix
+     * @param order The storage order of data
+     */
+    Matrix(float *data, int h, int w, MatrixOrder order = MatrixOrder::ROW_MAJOR)
+        : data(data), h(h), w(w), order(order)
+    {}
+
+    /**
+     * @brief Distance in floats between (i, j) and (i + 1, j)
      */
-    Matrix(std::vector<float> &data, int h, int w) : data(data.data()), h(h), w(w) {}
+    size_t RowStride() const { return order == MatrixOrder::ROW_MAJOR ? w : 1; }
+
+    /**
+     * @brief Distance in floats between (i, j) and (i, j + 1)
+     */
+    size_t ColStride() const { return order == MatrixOrder::ROW_MAJOR ? 1 : h; }
+
+    /**
+     * @brief Get the address of element (i, j) in either order
+     */
+    float *Ptr(int i, int j) const { return data + i * RowStride() + j * ColStride(); }
 
 public:
-    float *data; /**< Pointer to the data for the matrix */
-    int h;       /**< The height of the matrix */
-    int w;       /**< The width of the matrix */
+    float *data;       /**< Pointer to the data for the matrix */
+    int h;             /**< The height of the matrix */
+    int w;             /**< The width of the matrix */
+    MatrixOrder order; /**< The storage order of data, kernels without KernelInfo::AnyOrder need ROW_MAJOR */
+};
+
+struct CheckSummary {
+    float maxAbsError = 0.0f;   /**< The largest |expect - actual| */
+    float maxRelError = 0.0f;   /**< The largest |expect - actual| / |expect| */
+    uint32_t maxUlp = 0;        /**< The largest distance in units in the last place */
+    double rmsError = 0.0;      /**< The root mean square of expect - actual */
+    long mismatchNum = 0;       /**< The number of elements outside the tolerance */
+    int maxAbsRow = -1;         /**< The row of the element with the largest absolute error */
+    int maxAbsCol = -1;         /**< The column of the element with the largest absolute error */
+    int failRow = -1;           /**< The row of the first element outside the tolerance, -1 if none is */
+    int failCol = -1;           /**< The column of the first element outside the tolerance, -1 if none is */
+    float absTolerance = 0.0f;  /**< The absolute tolerance used */
+    float relTolerance = 0.0f;  /**< The K-scaled relative tolerance used */
+    bool passed = false;        /**< Whether every element is within tolerance */
+};
+
+struct AbftReport {
+    int faultRow = -1;       /**< The row of c to corrupt between the multiply and the verify, -1 injects nothing */
+    int faultCol = -1;       /**< The column of c to corrupt between the multiply and the verify */
+    int detectedNum = 0;     /**< The number of column blocks whose checksums disagreed */
+    int correctedNum = 0;    /**< The number of single element errors corrected */
+    int row = -1;            /**< The row of the last corrected element */
+    int col = -1;            /**< The column of the last corrected element */
+    float residual = 0.0f;   /**< The error removed from the last corrected element */
 };
 
 class GeMM {
 public:
-    static bool CheckResult(Matrix &a, Matrix &b);
+    static CheckSummary CheckResult(Matrix &a, Matrix &b, int k = 1);
+    static bool CheckFreivalds(Matrix &a, Matrix &b, Matrix &c, int rounds = 3);
     static void Origin(Matrix &a, Matrix &b, Matrix &c);
+    static void Reference(Matrix &a, Matrix &b, Matrix &c);
     static void Optimize1(Matrix &a, Matrix &b, Matrix &c);
     static void Optimize2(Matrix &a, Matrix &b, Matrix &c);
     static void Optimize3(Matrix &a, Matrix &b, Matrix &c);
@@ -47,6 +112,18 @@ public:
     static void Optimize14(Matrix &a, Matrix &b, Matrix &c);
     static void Optimize15(Matrix &a, Matrix &b, Matrix &c);
     static void Optimize16(Matrix &a, Matrix &b, Matrix &c);
+    static void Optimize17(Matrix &a, Matrix &b, Matrix &c);
+    static void Optimize18(Matrix &a, Matrix &b, Matrix &c);
+    static void Packed(Matrix &a, Matrix &b, Matrix &c);
+    static void PackedStream(Matrix &a, Matrix &b, Matrix &c);
+    static void Strassen(Matrix &a, Matrix &b, Matrix &c);
+    static void Recursive(Matrix &a, Matrix &b, Matrix &c);
+    static void Tiled(Matrix &a, Matrix &b, Matrix &c);
+    static void Morton(Matrix &a, Matrix &b, Matrix &c);
+    static void Csr(Matrix &a, Matrix &b, Matrix &c);
+    static void Bsr(Matrix &a, Matrix &b, Matrix &c);
+    static bool PackedAbft(Matrix &a, Matrix &b, Matrix &c, AbftReport &report);
+    static void Auto(Matrix &a, Matrix &b, Matrix &c);
 
 private:
     static bool CheckParam(Matrix &a, Matrix &b, Matrix &c);
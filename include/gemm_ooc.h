@@ -0,0 +1,40 @@
+#ifndef GEMM_OOC_H
+#define GEMM_OOC_H
+
+#include <cstdint>
+#include <string>
+
+struct OocStats {
+    double wallSeconds = 0.0;    /**< Time of the whole product */
+    double computeSeconds = 0.0; /**< Time spent in the in-memory kernel */
+    double ioSeconds = 0.0;      /**< Time the I/O threads spent reading and writing tiles */
+    double stallSeconds = 0.0;   /**< Time the compute thread waited for I/O */
+    long tileNum = 0;            /**< The number of tile products */
+    uint64_t bytesRead = 0;      /**< Bytes read from the a and b files */
+    uint64_t bytesWritten = 0;   /**< Bytes written to the c file */
+};
+
+/**
+ * @brief c = a * b on matrix files that need not fit in memory. c is split into tile x tile blocks and every block
+ * sums tile products of a and b blocks read with pread. the blocks of the next product are read and the finished
+ * c blocks written on I/O threads while the packed kernel multiplies the current blocks, so with enough compute
+ * per block the I/O is hidden. at most two blocks of each of a, b and c are in memory
+ *
+ * @param pathA The matrix file of a
+ * @param pathB The matrix file of b
+ * @param pathC The matrix file of c, created or truncated
+ * @param tile The edge of the blocks
+ * @param stats Timing of compute and I/O
+ * @return true if every file could be read and written
+ */
+bool OutOfCoreGemm(const std::string &pathA, const std::string &pathB, const std::string &pathC, int tile,
+    OocStats &stats);
+
+/**
+ * @brief Read the size of a matrix file from its header alone, the payload is neither read nor mapped
+ *
+ * @return true if the file has a valid header
+ */
+bool ReadMatrixFileShape(const std::string &path, int &h, int &w);
+
+#endif  // GEMM_OOC_H
@@ -0,0 +1,62 @@
+#ifndef GEMM_PACKED_H
+#define GEMM_PACKED_H
+
+#include <vector>
+#include "micro_kernel.h"
+#include "gemm.h"
+
+enum class LoopOrder {
+    NKM = 0, /**< jc, pc, ic: one packed b block shared by all threads (Goto's order) */
+    MKN = 1, /**< ic, pc, jc: every thread keeps its packed a block and packs b blocks on its own */
+};
+
+struct PackParams {
+    int mc = 128;                         /**< Rows of a per packed block */
+    int kc = 256;                         /**< Depth per packed block */
+    int nc = 2048;                        /**< Columns of b per packed block */
+    int mr = 4;                           /**< Rows of the register tile */
+    int nr = 4;                           /**< Columns of the register tile */
+    int unroll = 4;                       /**< Unroll factor of the k loop inside the micro kernel */
+    int prefetch = 8;                     /**< Software prefetch distance in k steps, 0 disables it */
+    LoopOrder loopOrder = LoopOrder::NKM; /**< Order of the block loops */
+};
+
+/**
+ * c[0:mr][0:nr] += packed a panel * packed b panel over kc, panels are prefetched prefetch k steps ahead,
+ * store is a combination of the STORE_ flags of micro_kernel.h
+ */
+using MicroKernelFunc = void (*)(int kc, const float *pA, const float *pB, float *pC, int ldc, int prefetch,
+    int store);
+
+struct MicroKernelInfo {
+    int mr;
+    int nr;
+    int unroll;
+    MicroKernelFunc func;
+};
+
+constexpr int PACK_TILE_MAX = 256;
+
+/**
+ * @brief All micro kernels the packed path can use
+ */
+const std::vector<MicroKernelInfo> &GetMicroKernels();
+
+/**
+ * @brief Find the micro kernel for a register tile shape and unroll factor
+ *
+ * @return const MicroKernelInfo* The micro kernel, nullptr if there is none
+ */
+const MicroKernelInfo *FindMicroKernel(int mr, int nr, int unroll);
+
+/**
+ * @brief c += a * b on packed panels with the given parameters, no parameter check and no timing
+ *
+ * @param report Accumulate ABFT checksums and verify c when set, forces LoopOrder::NKM
+ * @param store STORE_OVERWRITE computes c = a * b without reading c, STORE_STREAM writes the final tiles with
+ * non-temporal stores when c is aligned for them. both are ignored when report is set
+ */
+void PackedImpl(Matrix &a, Matrix &b, Matrix &c, const PackParams &params, AbftReport *report,
+    int store = STORE_ACCUMULATE);
+
+#endif  // GEMM_PACKED_H
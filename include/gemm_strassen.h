@@ -0,0 +1,31 @@
+#ifndef GEMM_STRASSEN_H
+#define GEMM_STRASSEN_H
+
+#include "gemm.h"
+
+struct StrassenParams {
+    int depth = 2;    /**< Maximum number of Strassen-Winograd levels, 0 runs the packed kernel directly */
+    int cutoff = 512; /**< Smallest m, n or k a level may split down to */
+};
+
+/**
+ * @brief Set the parameters GeMM::Strassen uses
+ */
+void SetStrassenParams(const StrassenParams &params);
+
+const StrassenParams &GetStrassenParams();
+
+/**
+ * @brief Get the number of levels StrassenImpl runs for a shape, every level halves m, n and k
+ */
+int GetStrassenLevels(int m, int n, int k, const StrassenParams &params);
+
+/**
+ * @brief c = a * b with Strassen-Winograd levels (7 products and 15 additions per level) over the packed kernel,
+ * no parameter check and no timing. m, n and k are zero padded to a multiple of 2^levels, the padded copies,
+ * sums and products live in the calling thread's Workspace. every level costs a few units in the last place of
+ * accuracy, see the report of --strassen-report
+ */
+void StrassenImpl(Matrix &a, Matrix &b, Matrix &c, const StrassenParams &params);
+
+#endif  // GEMM_STRASSEN_H
@@ -0,0 +1,172 @@
+#ifndef KERNEL_REGISTRY_H
+#define KERNEL_REGISTRY_H
+
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "gemm.h"
+
+using KernelFunc = std::function<void(Matrix &, Matrix &, Matrix &)>;
+
+enum IsaFlag : uint32_t {
+    ISA_NONE = 0,
+    ISA_NEON = 1 << 0,
+};
+
+#ifdef __ARM_NEON
+constexpr int NEON_WIDTH = 4;
+#else
+constexpr int NEON_WIDTH = 1;
+#endif
+
+struct KernelInfo {
+    KernelInfo(const std::string &name, const std::string &description, KernelFunc func)
+        : name(name), description(description), func(std::move(func))
+    {}
+
+    /* chainable setters for registration */
+    KernelInfo &Isa(uint32_t flags)
+    {
+        isa = flags;
+        return *this;
+    }
+    KernelInfo &Dtype(const std::string &type)
+    {
+        dtype = type;
+        return *this;
+    }
+    KernelInfo &Align(int m, int n, int k)
+    {
+        alignM = m;
+        alignN = n;
+        alignK = k;
+        tail = false;
+        return *this;
+    }
+    KernelInfo &AlignBytes(int bytes)
+    {
+        alignBytes = bytes;
+        return *this;
+    }
+    KernelInfo &SizeRange(int min, int max)
+    {
+        minSize = min;
+        maxSize = max;
+        return *this;
+    }
+    KernelInfo &Vector(int width)
+    {
+        vectorWidth = width;
+        return *this;
+    }
+    KernelInfo &Cost(float eff, float use)
+    {
+        efficiency = eff;
+        reuse = use;
+        return *this;
+    }
+    KernelInfo &Parallel()
+    {
+        parallel = true;
+        return *this;
+    }
+    KernelInfo &Tuned()
+    {
+        tuned = true;
+        return *this;
+    }
+    KernelInfo &Manual()
+    {
+        autoSelect = false;
+        return *this;
+    }
+    KernelInfo &AnyOrder()
+    {
+        anyOrder = true;
+        return *this;
+    }
+
+    std::string name;                 /**< Unique kernel name */
+    std::string description;          /**< Loop order and optimizations of the kernel */
+    KernelFunc func;                  /**< c += a * b, or c = a * b for the Manual kernels that say so */
+    uint32_t isa = ISA_NONE;          /**< IsaFlag bits the kernel needs to produce any result */
+    std::string dtype = "f32";        /**< Element type of a, b and c */
+    int alignM = 1;                   /**< m must be a multiple of alignM unless tail is set */
+    int alignN = 1;                   /**< n must be a multiple of alignN unless tail is set */
+    int alignK = 1;                   /**< k must be a multiple of alignK unless tail is set */
+    int alignBytes = 4;               /**< Alignment the kernel needs for the data pointers */
+    bool tail = true;                 /**< Whether the remainders of m, n and k are computed */
+    int minSize = 0;                  /**< Lower end of the max(m, n, k) range the kernel is meant for */
+    int maxSize = INT_MAX;            /**< Upper end of the max(m, n, k) range the kernel is meant for */
+    int vectorWidth = 1;              /**< Floats per FMA instruction in the inner loop */
+    float efficiency = 1.0f;          /**< Fraction of the FMA peak reached while the operands are in cache */
+    float reuse = 1.0f;               /**< FMAs per float streamed from memory once b exceeds the LLC */
+    bool parallel = false;            /**< Whether the kernel runs on the thread pool */
+    bool tuned = false;               /**< Whether the autotuner holds measured GFLOPS for the kernel */
+    bool autoSelect = true;           /**< Whether GeMM::Auto may pick the kernel */
+    bool anyOrder = false;            /**< Whether a and b may be column major, c is always row major */
+};
+
+class KernelRegistry {
+public:
+    static KernelRegistry &GetInstance();
+
+    /**
+     * @brief Add a kernel, the list stays in natural name order (Optimize2 before Optimize10)
+     *
+     * @return true if the name was not registered yet
+     */
+    bool Register(const KernelInfo &info);
+
+    const std::vector<KernelInfo> &GetKernels() const { return m_kernels; }
+
+    /**
+     * @brief Find a kernel by name
+     *
+     * @return const KernelInfo* The kernel, nullptr if there is none
+     */
+    const KernelInfo *Find(const std::string &name) const;
+
+    /**
+     * @brief Find the kernels whose names match a shell glob pattern such as 'Optimize1*'
+     */
+    std::vector<const KernelInfo *> Match(const std::string &pattern) const;
+
+    /**
+     * @brief Get the IsaFlag bits supported by this build and host
+     */
+    static uint32_t GetHostIsa();
+
+    /**
+     * @brief Get a readable form of IsaFlag bits, "none" for ISA_NONE
+     */
+    static std::string IsaToString(uint32_t isa);
+
+    /**
+     * @brief Whether the kernel computes the complete product for this shape and data on this host
+     */
+    static bool IsSupported(const KernelInfo &info, Matrix &a, Matrix &b, Matrix &c);
+
+private:
+    KernelRegistry() = default;
+
+private:
+    std::vector<KernelInfo> m_kernels;
+};
+
+class KernelRegistrar {
+public:
+    explicit KernelRegistrar(const KernelInfo &info) { KernelRegistry::GetInstance().Register(info); }
+};
+
+/**
+ * register a kernel at static initialization, use once per kernel at namespace scope of its source file
+ */
+#ifndef REGISTER_KERNEL
+#define REGISTER_KERNEL(id, info) static KernelRegistrar g_kernelRegistrar##id(info)
+#endif  // REGISTER_KERNEL
+
+#endif  // KERNEL_REGISTRY_H
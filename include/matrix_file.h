@@ -0,0 +1,104 @@
+#ifndef MATRIX_FILE_H
+#define MATRIX_FILE_H
+
+#include <cstdint>
+#include <string>
+#include "allocator.h"
+#include "gemm.h"
+
+constexpr char MATRIX_FILE_MAGIC[8] = {'G', 'E', 'M', 'M', 'M', 'A', 'T', '\0'};
+constexpr uint32_t MATRIX_FILE_VERSION = 1;
+
+enum MatrixDtype : uint32_t {
+    MATRIX_DTYPE_F32 = 0,
+};
+
+/**
+ * little endian header at offset 0 of a matrix file, row i of the payload starts at
+ * dataOffset + i * stride * element size
+ */
+struct MatrixFileHeader {
+    char magic[8];       /**< MATRIX_FILE_MAGIC */
+    uint32_t version;    /**< MATRIX_FILE_VERSION */
+    uint32_t dtype;      /**< MatrixDtype of the payload */
+    uint64_t rows;       /**< Height of the matrix */
+    uint64_t cols;       /**< Width of the matrix */
+    uint64_t stride;     /**< Elements from the start of one row to the next, at least cols */
+    uint64_t alignment;  /**< Alignment of the payload in bytes, a power of two */
+    uint64_t dataOffset; /**< Offset of the payload in bytes, a multiple of alignment */
+    uint64_t reserved;   /**< Zero */
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "the matrix file header is 64 bytes");
+
+/**
+ * @brief Build the header of a dense h x w f32 matrix file whose payload starts at the first aligned offset
+ */
+MatrixFileHeader MakeMatrixHeader(int h, int w, size_t alignment = CACHE_LINE_BYTES);
+
+/**
+ * @brief Check a header read from a file of fileLength bytes, what is wrong is logged
+ *
+ * @return true if the header describes an f32 matrix that fits in the file
+ */
+bool ValidateMatrixHeader(const MatrixFileHeader &header, size_t fileLength, const std::string &path);
+
+/**
+ * a matrix file mapped into memory, the Matrix it hands out points straight into the mapping
+ */
+class MappedMatrix {
+public:
+    MappedMatrix() = default;
+    ~MappedMatrix();
+    MappedMatrix(const MappedMatrix &) = delete;
+    MappedMatrix &operator=(const MappedMatrix &) = delete;
+
+    /**
+     * @brief Map an existing matrix file read only, pages are read on first access so the file may be larger than
+     * memory. the payload is used in place unless its stride differs from its width, then it is copied into a
+     * dense buffer. the matrix must not be written
+     *
+     * @param path The matrix file
+     * @return true if the file is a valid f32 matrix file
+     */
+    bool Open(const std::string &path);
+
+    /**
+     * @brief Create or truncate a matrix file of h x w zeros and map it shared, so whatever is written to the matrix
+     * ends up in the file
+     *
+     * @param path The matrix file
+     * @param h The height of the matrix
+     * @param w The width of the matrix
+     * @param alignment Alignment of the payload in bytes, a power of two
+     * @return true if the file was created and mapped
+     */
+    bool Create(const std::string &path, int h, int w, size_t alignment = CACHE_LINE_BYTES);
+
+    /**
+     * @brief Flush a mapping from Create to the file
+     */
+    bool Sync();
+
+    Matrix GetMatrix() const { return Matrix(m_data, m_h, m_w); }
+
+private:
+    void Close();
+
+private:
+    void *m_map = nullptr;
+    size_t m_length = 0;
+    Buffer<float> m_copy;
+    float *m_data = nullptr;
+    int m_h = 0;
+    int m_w = 0;
+};
+
+/**
+ * @brief Write a row major matrix to a matrix file with a dense stride
+ *
+ * @return true if the file was written, false for a column major matrix
+ */
+bool WriteMatrixFile(const std::string &path, const Matrix &matrix, size_t alignment = CACHE_LINE_BYTES);
+
+#endif  // MATRIX_FILE_H
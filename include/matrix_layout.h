@@ -0,0 +1,73 @@
+#ifndef MATRIX_LAYOUT_H
+#define MATRIX_LAYOUT_H
+
+#include <cstdint>
+#include <vector>
+#include "allocator.h"
+#include "gemm.h"
+
+constexpr int LAYOUT_TILE = 64;
+constexpr int LAYOUT_TILE_SIZE = LAYOUT_TILE * LAYOUT_TILE;
+
+enum class BlockLayout {
+    TILED = 0,  /**< Tiles in row major order of their tile coordinates */
+    MORTON = 1, /**< Tiles in Z order of their tile coordinates, neighbours in both directions stay close */
+};
+
+/**
+ * a matrix stored as LAYOUT_TILE x LAYOUT_TILE tiles, each tile a dense row major block of LAYOUT_TILE_SIZE floats,
+ * the order of the tiles in memory set by the layout. the last tile row and column are zero padded, so kernels on
+ * blocked matrices have no edge cases and their results can feed the next product without repacking
+ */
+class BlockedMatrix {
+public:
+    BlockedMatrix() = default;
+
+    /**
+     * @brief Construct a zeroed h x w blocked matrix
+     */
+    BlockedMatrix(int h, int w, BlockLayout layout);
+
+    float *Tile(int ti, int tj)
+    {
+        return m_data.data() + static_cast<size_t>(m_slots[ti * m_tileCols + tj]) * LAYOUT_TILE_SIZE;
+    }
+    const float *Tile(int ti, int tj) const
+    {
+        return m_data.data() + static_cast<size_t>(m_slots[ti * m_tileCols + tj]) * LAYOUT_TILE_SIZE;
+    }
+
+    int GetHeight() const { return m_h; }
+    int GetWidth() const { return m_w; }
+    int GetTileRows() const { return m_tileRows; }
+    int GetTileCols() const { return m_tileCols; }
+    BlockLayout GetLayout() const { return m_layout; }
+
+private:
+    Buffer<float> m_data;
+    std::vector<uint32_t> m_slots; /**< Storage slot of tile (ti, tj) at ti * tileCols + tj */
+    int m_h = 0;
+    int m_w = 0;
+    int m_tileRows = 0;
+    int m_tileCols = 0;
+    BlockLayout m_layout = BlockLayout::TILED;
+};
+
+/**
+ * @brief Copy a row major matrix into a blocked matrix of the same size, a column major one is rejected
+ */
+void ToBlocked(const Matrix &src, BlockedMatrix &dst);
+
+/**
+ * @brief Copy a blocked matrix into a row major matrix of the same size
+ */
+void FromBlocked(const BlockedMatrix &src, Matrix &dst);
+
+/**
+ * @brief c += a * b directly on blocked matrices of any layouts, rows of c tiles split across the thread pool
+ *
+ * @return false if the sizes do not match
+ */
+bool BlockedGemm(const BlockedMatrix &a, const BlockedMatrix &b, BlockedMatrix &c);
+
+#endif  // MATRIX_LAYOUT_H
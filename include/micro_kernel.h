@@ -0,0 +1,380 @@
+#ifndef MICRO_KERNEL_H
+#define MICRO_KERNEL_H
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+/**
+ * a vector of WIDTH elements of T and the operations the micro kernels are built from,
+ * the generic version holds a single scalar so every element type has a fallback
+ */
+template <typename T>
+struct VectorTraits {
+    using Type = T;
+    static constexpr int WIDTH = 1;
+    static constexpr int REGISTERS = 0; /**< No vector register file, every register tile is accepted */
+    static inline Type Zero() { return T(0); }
+    /* a in every lane */
+    static inline Type Set(T a) { return a; }
+    static inline Type Load(const T *p) { return *p; }
+    static inline void Store(T *p, Type v) { *p = v; }
+    /* non-temporal store that bypasses the caches, p is aligned to the vector size */
+    static inline void StoreStream(T *p, Type v) { *p = v; }
+    static inline Type Add(Type x, Type y) { return x + y; }
+    /* acc + b * a with the scalar a broadcast to every lane */
+    static inline Type Fma(Type acc, Type b, T a) { return acc + b * a; }
+    /* acc + x * y lane by lane */
+    static inline Type MulAdd(Type acc, Type x, Type y) { return acc + x * y; }
+    /* sum of the lanes */
+    static inline T ReduceAdd(Type v) { return v; }
+    static inline Type Sub(Type x, Type y) { return x - y; }
+    static inline Type Mul(Type x, Type y) { return x * y; }
+    static inline Type Div(Type x, Type y) { return x / y; }
+    static inline Type Max(Type x, Type y) { return x < y ? y : x; }
+    static inline Type Abs(Type x) { return x < T(0) ? -x : x; }
+    /* largest lane */
+    static inline T ReduceMax(Type v) { return v; }
+    /* number of lanes where x <= y does not hold, NaN lanes included */
+    static inline int CountNotLessEqual(Type x, Type y) { return !(x <= y); }
+
+    /* per lane distances in units in the last place between 32 bit floats */
+    using UlpType = uint32_t;
+    static inline UlpType UlpZero() { return 0; }
+    /* lane by lane max of acc and the ulp distance of x and y, the sign magnitude bits are mapped to ordered
+     * integers so distances across zero count the floats between them */
+    static inline UlpType UlpMax(UlpType acc, Type x, Type y)
+    {
+        static_assert(sizeof(T) == sizeof(int32_t), "ulp distances need 32 bit elements");
+        int32_t bitsX;
+        int32_t bitsY;
+        memcpy(&bitsX, &x, sizeof(x));
+        memcpy(&bitsY, &y, sizeof(y));
+        int64_t orderedX = bitsX < 0 ? static_cast<int64_t>(INT32_MIN) - bitsX : bitsX;
+        int64_t orderedY = bitsY < 0 ? static_cast<int64_t>(INT32_MIN) - bitsY : bitsY;
+        uint32_t distance = static_cast<uint32_t>(orderedX > orderedY ? orderedX - orderedY : orderedY - orderedX);
+        return distance > acc ? distance : acc;
+    }
+    static inline uint32_t ReduceUlp(UlpType v) { return v; }
+};
+
+#ifdef __ARM_NEON
+template <>
+struct VectorTraits<float> {
+    using Type = float32x4_t;
+    static constexpr int WIDTH = 4;
+#ifdef __aarch64__
+    static constexpr int REGISTERS = 32;
+#else
+    static constexpr int REGISTERS = 16;
+#endif
+    static inline Type Zero() { return vdupq_n_f32(0.0f); }
+    static inline Type Set(float a) { return vdupq_n_f32(a); }
+    static inline Type Load(const float *p) { return vld1q_f32(p); }
+    static inline void Store(float *p, Type v) { vst1q_f32(p, v); }
+#ifdef __aarch64__
+    static inline void StoreStream(float *p, Type v)
+    {
+        asm volatile("stnp %d1, %d2, [%0]" : : "r"(p), "w"(vget_low_f32(v)), "w"(vget_high_f32(v)) : "memory");
+    }
+#else
+    static inline void StoreStream(float *p, Type v) { vst1q_f32(p, v); }
+#endif
+    static inline Type Add(Type x, Type y) { return vaddq_f32(x, y); }
+#ifdef __aarch64__
+    static inline Type Fma(Type acc, Type b, float a) { return vfmaq_n_f32(acc, b, a); }
+    static inline Type MulAdd(Type acc, Type x, Type y) { return vfmaq_f32(acc, x, y); }
+#elif defined(__ARM_FEATURE_FMA)
+    /* armv7 with VFPv4 has the fused vector form but no by-scalar one */
+    static inline Type Fma(Type acc, Type b, float a) { return vfmaq_f32(acc, b, vdupq_n_f32(a)); }
+    static inline Type MulAdd(Type acc, Type x, Type y) { return vfmaq_f32(acc, x, y); }
+#else
+    static inline Type Fma(Type acc, Type b, float a) { return vmlaq_n_f32(acc, b, a); }
+    static inline Type MulAdd(Type acc, Type x, Type y) { return vmlaq_f32(acc, x, y); }
+#endif
+    static inline Type Sub(Type x, Type y) { return vsubq_f32(x, y); }
+    static inline Type Mul(Type x, Type y) { return vmulq_f32(x, y); }
+    static inline Type Max(Type x, Type y) { return vmaxq_f32(x, y); }
+    static inline Type Abs(Type x) { return vabsq_f32(x); }
+#ifdef __aarch64__
+    static inline float ReduceAdd(Type v) { return vaddvq_f32(v); }
+    static inline Type Div(Type x, Type y) { return vdivq_f32(x, y); }
+    static inline float ReduceMax(Type v) { return vmaxvq_f32(v); }
+    static inline uint32_t ReduceCount(uint32x4_t v) { return vaddvq_u32(v); }
+#else
+    static inline float ReduceAdd(Type v)
+    {
+        float32x2_t sum = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpadd_f32(sum, sum), 0);
+    }
+    static inline Type Div(Type x, Type y)
+    {
+        float32x4_t inverse = vrecpeq_f32(y);
+        inverse = vmulq_f32(vrecpsq_f32(y, inverse), inverse);
+        inverse = vmulq_f32(vrecpsq_f32(y, inverse), inverse);
+        return vmulq_f32(x, inverse);
+    }
+    static inline float ReduceMax(Type v)
+    {
+        float32x2_t max = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+        return vget_lane_f32(vpmax_f32(max, max), 0);
+    }
+    static inline uint32_t ReduceCount(uint32x4_t v)
+    {
+        uint32x2_t sum = vadd_u32(vget_low_u32(v), vget_high_u32(v));
+        return vget_lane_u32(vpadd_u32(sum, sum), 0);
+    }
+#endif
+    static inline int CountNotLessEqual(Type x, Type y)
+    {
+        return static_cast<int>(ReduceCount(vshrq_n_u32(vmvnq_u32(vcleq_f32(x, y)), 31)));
+    }
+
+    using UlpType = uint32x4_t;
+    static inline UlpType UlpZero() { return vdupq_n_u32(0); }
+    static inline int32x4_t Ordered(Type v)
+    {
+        int32x4_t bits = vreinterpretq_s32_f32(v);
+        return vbslq_s32(vcltq_s32(bits, vdupq_n_s32(0)), vsubq_s32(vdupq_n_s32(INT32_MIN), bits), bits);
+    }
+    static inline UlpType UlpMax(UlpType acc, Type x, Type y)
+    {
+        return vmaxq_u32(acc, vreinterpretq_u32_s32(vabdq_s32(Ordered(x), Ordered(y))));
+    }
+    static inline uint32_t ReduceUlp(UlpType v)
+    {
+        uint32x2_t max = vpmax_u32(vget_low_u32(v), vget_high_u32(v));
+        return vget_lane_u32(vpmax_u32(max, max), 0);
+    }
+};
+#elif defined(__SSE2__)
+/* 128 bit like NEON so that every register tile of the table fits the same NR multiples */
+template <>
+struct VectorTraits<float> {
+    using Type = __m128;
+    static constexpr int WIDTH = 4;
+#ifdef __x86_64__
+    static constexpr int REGISTERS = 16;
+#else
+    static constexpr int REGISTERS = 8;
+#endif
+    static inline Type Zero() { return _mm_setzero_ps(); }
+    static inline Type Set(float a) { return _mm_set1_ps(a); }
+    static inline Type Load(const float *p) { return _mm_loadu_ps(p); }
+    static inline void Store(float *p, Type v) { _mm_storeu_ps(p, v); }
+    static inline void StoreStream(float *p, Type v) { _mm_stream_ps(p, v); }
+    static inline Type Add(Type x, Type y) { return _mm_add_ps(x, y); }
+#ifdef __FMA__
+    static inline Type Fma(Type acc, Type b, float a) { return _mm_fmadd_ps(b, _mm_set1_ps(a), acc); }
+    static inline Type MulAdd(Type acc, Type x, Type y) { return _mm_fmadd_ps(x, y, acc); }
+#else
+    static inline Type Fma(Type acc, Type b, float a) { return _mm_add_ps(acc, _mm_mul_ps(b, _mm_set1_ps(a))); }
+    static inline Type MulAdd(Type acc, Type x, Type y) { return _mm_add_ps(acc, _mm_mul_ps(x, y)); }
+#endif
+    static inline float ReduceAdd(Type v)
+    {
+        Type sum = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+    }
+    static inline Type Sub(Type x, Type y) { return _mm_sub_ps(x, y); }
+    static inline Type Mul(Type x, Type y) { return _mm_mul_ps(x, y); }
+    static inline Type Div(Type x, Type y) { return _mm_div_ps(x, y); }
+    static inline Type Max(Type x, Type y) { return _mm_max_ps(x, y); }
+    static inline Type Abs(Type x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+    static inline float ReduceMax(Type v)
+    {
+        Type max = _mm_max_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_max_ss(max, _mm_shuffle_ps(max, max, 1)));
+    }
+    static inline int CountNotLessEqual(Type x, Type y)
+    {
+        return __builtin_popcount(_mm_movemask_ps(_mm_cmpnle_ps(x, y)));
+    }
+
+    using UlpType = __m128i;
+    static inline UlpType UlpZero() { return _mm_setzero_si128(); }
+    static inline __m128i Ordered(Type v)
+    {
+        __m128i bits = _mm_castps_si128(v);
+        __m128i negative = _mm_srai_epi32(bits, 31);
+        __m128i flipped = _mm_sub_epi32(_mm_set1_epi32(INT32_MIN), bits);
+        return _mm_or_si128(_mm_and_si128(negative, flipped), _mm_andnot_si128(negative, bits));
+    }
+    /* SSE2 has no unsigned 32 bit max, the distances are compared with their sign bits flipped */
+    static inline UlpType UlpMax(UlpType acc, Type x, Type y)
+    {
+        __m128i orderedX = Ordered(x);
+        __m128i orderedY = Ordered(y);
+        __m128i greater = _mm_cmpgt_epi32(orderedX, orderedY);
+        __m128i distance = _mm_or_si128(_mm_and_si128(greater, _mm_sub_epi32(orderedX, orderedY)),
+            _mm_andnot_si128(greater, _mm_sub_epi32(orderedY, orderedX)));
+        __m128i sign = _mm_set1_epi32(INT32_MIN);
+        __m128i larger = _mm_cmpgt_epi32(_mm_xor_si128(distance, sign), _mm_xor_si128(acc, sign));
+        return _mm_or_si128(_mm_and_si128(larger, distance), _mm_andnot_si128(larger, acc));
+    }
+    static inline uint32_t ReduceUlp(UlpType v)
+    {
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+        return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+};
+#endif
+
+constexpr int SIMD_WIDTH = VectorTraits<float>::WIDTH;
+
+/**
+ * whether the MR x NR accumulators of a register tile fit the vector registers next to one row of b and the
+ * broadcast of a, a tile that does not spills its accumulators every k step. true for the scalar fallback
+ */
+constexpr bool TileFitsRegisters(int mr, int nr)
+{
+    return VectorTraits<float>::REGISTERS == 0 ||
+           mr * nr / SIMD_WIDTH + nr / SIMD_WIDTH + 1 <= VectorTraits<float>::REGISTERS;
+}
+constexpr int CACHE_LINE_FLOATS = 16;
+
+/* prefetch hints, a hint on an address past the end of a buffer does not fault */
+#define PREFETCH_READ(p) __builtin_prefetch((p), 0, 3)
+#define PREFETCH_WRITE(p) __builtin_prefetch((p), 1, 3)
+
+/* how MicroKernel writes its c tile, STORE_OVERWRITE and STORE_STREAM combine */
+constexpr int STORE_ACCUMULATE = 0;     /**< c += tile */
+constexpr int STORE_OVERWRITE = 1 << 0; /**< c = tile, c is never read */
+constexpr int STORE_STREAM = 1 << 1;    /**< Non-temporal stores, c rows aligned to SIMD_WIDTH floats */
+
+/**
+ * order the non-temporal stores of this thread before the stores that follow, call it before other threads
+ * may read what was streamed
+ */
+inline void StreamFence()
+{
+#if defined(__SSE2__)
+    _mm_sfence();
+#elif defined(__aarch64__)
+    asm volatile("dmb ishst" : : : "memory");
+#endif
+}
+
+/**
+ * prefetch every cache line of p[0:len] for reading
+ */
+inline void PrefetchRow(const float *p, int len)
+{
+    for (int j = 0; j < len; j += CACHE_LINE_FLOATS) {
+        PREFETCH_READ(p + j);
+    }
+}
+
+template <typename F, int... I>
+inline void StaticForImpl(F &f, std::integer_sequence<int, I...>)
+{
+    (f(std::integral_constant<int, I>()), ...);
+}
+
+/**
+ * call f(std::integral_constant<int, 0>()) ... f(std::integral_constant<int, N - 1>()), the index is a compile
+ * time constant so the loop unrolls completely and arrays indexed by it can live in registers
+ */
+template <int N, typename F>
+inline void StaticFor(F &&f)
+{
+    StaticForImpl(f, std::make_integer_sequence<int, N>());
+}
+
+/**
+ * c[0:MR][0:NR] += a panel * b panel over kc, a panel element (p, ir) at p * MR + ir and b panel element (p, jr)
+ * at p * NR + jr. the MR x NR tile of c is held in MR * NR / WIDTH vector accumulators for the whole kc loop,
+ * so c is read and written once, and the k loop is unrolled UNROLL times.
+ * with prefetch > 0 the c tile is prefetched for writing up front and both panels prefetch steps ahead,
+ * store is a combination of the STORE_ flags
+ */
+template <typename T, int MR, int NR, int UNROLL>
+void MicroKernel(int kc, const T *pA, const T *pB, T *pC, int ldc, int prefetch, int store)
+{
+    using V = VectorTraits<T>;
+    static_assert(NR % V::WIDTH == 0, "NR must be a multiple of the vector width");
+    constexpr int NV = NR / V::WIDTH;
+    typename V::Type acc[MR][NV];
+    StaticFor<MR>([&](auto ir) { StaticFor<NV>([&](auto jv) { acc[ir][jv] = V::Zero(); }); });
+    if (prefetch > 0 && !(store & STORE_OVERWRITE)) {
+        StaticFor<MR>([&](auto ir) { PREFETCH_WRITE(pC + ir * ldc); });
+    }
+    auto step = [&](const T *panelA, const T *panelB) {
+        if (prefetch > 0) {
+            PREFETCH_READ(panelA + prefetch * MR);
+            PREFETCH_READ(panelB + prefetch * NR);
+        }
+        typename V::Type vB[NV];
+        StaticFor<NV>([&](auto jv) { vB[jv] = V::Load(panelB + jv * V::WIDTH); });
+        StaticFor<MR>([&](auto ir) {
+            T valA = panelA[ir];
+            StaticFor<NV>([&](auto jv) { acc[ir][jv] = V::Fma(acc[ir][jv], vB[jv], valA); });
+        });
+    };
+    int p = 0;
+    for (; p + UNROLL <= kc; p += UNROLL) {
+        StaticFor<UNROLL>([&](auto u) { step(pA + u * MR, pB + u * NR); });
+        pA += MR * UNROLL;
+        pB += NR * UNROLL;
+    }
+    for (; p < kc; p++) {
+        step(pA, pB);
+        pA += MR;
+        pB += NR;
+    }
+    StaticFor<MR>([&](auto ir) {
+        StaticFor<NV>([&](auto jv) {
+            T *c = pC + ir * ldc + jv * V::WIDTH;
+            typename V::Type value = (store & STORE_OVERWRITE) ? acc[ir][jv] : V::Add(V::Load(c), acc[ir][jv]);
+            if (store & STORE_STREAM) {
+                V::StoreStream(c, value);
+            } else {
+                V::Store(c, value);
+            }
+        });
+    });
+}
+
+/**
+ * c[0:MR][0:NR] += a[0:MR][0:k] * b[0:k][0:NR] read in place from row major a and b, no packing.
+ * the MR x NR tile of c stays in vector accumulators across the full k loop and is written once,
+ * so the loop only loads a and b. with prefetch > 0 the row of b prefetch steps ahead is prefetched
+ */
+template <typename T, int MR, int NR>
+void MicroKernelRowMajor(int k, const T *pA, int lda, const T *pB, int ldb, T *pC, int ldc, int prefetch)
+{
+    using V = VectorTraits<T>;
+    static_assert(NR % V::WIDTH == 0, "NR must be a multiple of the vector width");
+    constexpr int NV = NR / V::WIDTH;
+    typename V::Type acc[MR][NV];
+    StaticFor<MR>([&](auto ir) { StaticFor<NV>([&](auto jv) { acc[ir][jv] = V::Zero(); }); });
+    for (int p = 0; p < k; p++) {
+        if (prefetch > 0) {
+            StaticFor<(NR + CACHE_LINE_FLOATS - 1) / CACHE_LINE_FLOATS>(
+                [&](auto line) { PREFETCH_READ(pB + prefetch * ldb + line * CACHE_LINE_FLOATS); });
+        }
+        typename V::Type vB[NV];
+        StaticFor<NV>([&](auto jv) { vB[jv] = V::Load(pB + jv * V::WIDTH); });
+        StaticFor<MR>([&](auto ir) {
+            T valA = pA[ir * lda + p];
+            StaticFor<NV>([&](auto jv) { acc[ir][jv] = V::Fma(acc[ir][jv], vB[jv], valA); });
+        });
+        pB += ldb;
+    }
+    StaticFor<MR>([&](auto ir) {
+        StaticFor<NV>([&](auto jv) {
+            T *c = pC + ir * ldc + jv * V::WIDTH;
+            V::Store(c, V::Add(V::Load(c), acc[ir][jv]));
+        });
+    });
+}
+
+#endif  // MICRO_KERNEL_H
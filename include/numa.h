@@ -0,0 +1,33 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Restrict the calling thread to a set of cpus with the sched_setaffinity syscall
+ *
+ * @return true if the kernel accepted the set
+ */
+bool BindThreadToCpus(const std::vector<int> &cpus);
+
+/**
+ * @brief Restrict the calling thread to the cpus of the index-th node of GetNumaNodes()
+ */
+bool BindThreadToNode(int index);
+
+/**
+ * @brief Place the pages of [addr, addr + bytes) on the index-th node of GetNumaNodes() with the mbind syscall,
+ * pages already touched are migrated. the range is widened to whole pages, so it must own the pages it touches
+ *
+ * @return true if the kernel accepted the policy
+ */
+bool BindMemoryToNode(void *addr, size_t bytes, int index);
+
+/**
+ * @brief Zero rows x rowLen floats with the rows split across the thread pool like the row blocks of the parallel
+ * kernels, so that with first touch placement every page lands on the node of the thread that computes it
+ */
+void ParallelFirstTouch(float *data, size_t rows, size_t rowLen);
+
+#endif  // NUMA_H
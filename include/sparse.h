@@ -0,0 +1,147 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <cstdint>
+#include <vector>
+#include "gemm.h"
+
+constexpr int BSR_BLOCK = 4;
+constexpr int BSR_BLOCK_SIZE = BSR_BLOCK * BSR_BLOCK;
+
+/**
+ * compressed sparse row matrix, the nonzeros of row i are values[rowPtr[i]:rowPtr[i + 1]] in the columns
+ * colIdx[rowPtr[i]:rowPtr[i + 1]], ascending
+ */
+class CsrMatrix {
+public:
+    CsrMatrix() = default;
+
+    /**
+     * @brief Compress the nonzeros of a row major dense matrix, a column major one is rejected and leaves an empty
+     * matrix
+     */
+    explicit CsrMatrix(const Matrix &dense);
+
+    int GetHeight() const { return m_h; }
+    int GetWidth() const { return m_w; }
+    int GetNonZeroNum() const { return static_cast<int>(m_values.size()); }
+    const int *GetRowPtr() const { return m_rowPtr.data(); }
+    const int *GetColIdx() const { return m_colIdx.data(); }
+    const float *GetValues() const { return m_values.data(); }
+
+private:
+    std::vector<int> m_rowPtr;
+    std::vector<int> m_colIdx;
+    std::vector<float> m_values;
+    int m_h = 0;
+    int m_w = 0;
+};
+
+/**
+ * block sparse row matrix of BSR_BLOCK x BSR_BLOCK blocks, block row bi holds the blocks
+ * rowPtr[bi]:rowPtr[bi + 1] at block columns colIdx[...], each a dense row major block of BSR_BLOCK_SIZE values.
+ * a block is stored when any of its elements is nonzero, the blocks past the edges are zero padded
+ */
+class BsrMatrix {
+public:
+    BsrMatrix() = default;
+
+    /**
+     * @brief Compress the nonzero blocks of a row major dense matrix, a column major one is rejected and leaves an
+     * empty matrix
+     */
+    explicit BsrMatrix(const Matrix &dense);
+
+    int GetHeight() const { return m_h; }
+    int GetWidth() const { return m_w; }
+    int GetBlockRows() const { return static_cast<int>(m_rowPtr.size()) - 1; }
+    int GetBlockNum() const { return static_cast<int>(m_colIdx.size()); }
+    const int *GetRowPtr() const { return m_rowPtr.data(); }
+    const int *GetColIdx() const { return m_colIdx.data(); }
+    const float *GetValues() const { return m_values.data(); }
+
+private:
+    std::vector<int> m_rowPtr;
+    std::vector<int> m_colIdx;
+    std::vector<float> m_values;
+    int m_h = 0;
+    int m_w = 0;
+};
+
+/**
+ * 2:4 structured sparse matrix, every group of 4 consecutive elements of a row keeps 2 values. row i holds
+ * 2 * groupNum values at values + i * 2 * groupNum, and for every group the positions of its 2 values inside the
+ * group as 2 bit indices, the 4 bits of group g in byte g / 2 of the row's indices, low nibble for even g
+ */
+class Sparse24Matrix {
+public:
+    Sparse24Matrix() = default;
+
+    /**
+     * @brief Compress a row major dense matrix, the 2 largest magnitudes of every group are kept, so a matrix
+     * that already follows the 2:4 pattern is stored exactly. the last group of a row only picks valid columns.
+     * a column major one is rejected and leaves an empty matrix
+     */
+    explicit Sparse24Matrix(const Matrix &dense);
+
+    /**
+     * @brief Expand into a row major dense matrix of the same size, the dropped elements as zeros
+     */
+    void ToDense(Matrix &dense) const;
+
+    int GetHeight() const { return m_h; }
+    int GetWidth() const { return m_w; }
+    int GetGroupNum() const { return m_groupNum; }
+    int GetIndexStride() const { return (m_groupNum + 1) / 2; }
+    const float *GetValues() const { return m_values.data(); }
+    const uint8_t *GetIndices() const { return m_indices.data(); }
+
+private:
+    std::vector<float> m_values;
+    std::vector<uint8_t> m_indices;
+    int m_h = 0;
+    int m_w = 0;
+    int m_groupNum = 0;
+};
+
+/**
+ * @brief c += a * b for sparse a and row major dense b and c. every nonzero a(i, p) adds a(i, p) * b row p to
+ * c row i with the columns in vector registers, rows of c split across the thread pool
+ *
+ * @return false if the sizes do not match or b or c is column major
+ */
+bool SpMM(const CsrMatrix &a, const Matrix &b, Matrix &c);
+
+/**
+ * @brief c += a * b for block sparse a, each block multiplies BSR_BLOCK rows of b into BSR_BLOCK rows of c,
+ * so every b vector loaded is used BSR_BLOCK times. block rows of c split across the thread pool
+ *
+ * @return false if the sizes do not match or b or c is column major
+ */
+bool SpMM(const BsrMatrix &a, const Matrix &b, Matrix &c);
+
+/**
+ * @brief c += a * b for 2:4 sparse a. b is packed in strips of columns so the 2 rows each group selects are
+ * gathered from L1 at fixed offsets, every kept value is one vector FMA per vector of the strip and the dropped
+ * half of a costs nothing. column strips split across the thread pool
+ *
+ * @return false if the sizes do not match or b or c is column major
+ */
+bool SpMM(const Sparse24Matrix &a, const Matrix &b, Matrix &c);
+
+/**
+ * @brief Sampled dense dense product, values[p] = a row i . b column j for the p-th nonzero (i, j) of mask, the
+ * mask values are not read. the dot products run along k in vector registers, 4 nonzeros of a row at a time
+ * share the loads of a row i. a row major b is transposed into the workspace so its columns are contiguous, on
+ * every call, so a caller that samples the same b repeatedly should pass it column major. a column major b is
+ * read in place. rows of mask split across the thread pool
+ *
+ * @param a The row major m x k matrix
+ * @param b The k x n matrix in either order
+ * @param mask The m x n sparsity pattern of the output
+ * @param values The mask.GetNonZeroNum() outputs in the order of the mask nonzeros
+ * @return false if the sizes or the order of a do not fit
+ */
+bool SDDMM(const Matrix &a, const Matrix &b, const CsrMatrix &mask, float *values);
+
+#endif  // SPARSE_H
@@ -0,0 +1,34 @@
+#ifndef TRANSPOSE_H
+#define TRANSPOSE_H
+
+#include <cstddef>
+#include "gemm.h"
+
+constexpr int TRANSPOSE_BLOCK = 32;
+
+/**
+ * @brief dst = src^T out of place. each TRANSPOSE_BLOCK x TRANSPOSE_BLOCK block is transposed in 4x4 register
+ * tiles into an L1 scratch block and then copied to the destination rows, with non-temporal stores when dst and
+ * ldd keep the rows on cache line boundaries and with regular stores otherwise, block rows are split across the
+ * thread pool. the edges that do not fill a 4x4 tile are copied one element at a time
+ *
+ * @param src The h x w source, row i at src + i * lds
+ * @param dst The w x h destination, row j at dst + j * ldd, must not overlap src
+ */
+void Transpose(const float *src, int h, int w, size_t lds, float *dst, size_t ldd);
+
+/**
+ * @brief Transpose a row major matrix into dst, dst must be w x h and row major, column major matrices are
+ * rejected
+ */
+void Transpose(const Matrix &src, Matrix &dst);
+
+/**
+ * @brief Transpose the n x n block at data in place, the blocks above the diagonal are swapped with the blocks
+ * below it through registers, so no scratch memory is needed
+ *
+ * @param data Row i at data + i * ld
+ */
+void TransposeInPlace(float *data, int n, size_t ld);
+
+#endif  // TRANSPOSE_H
@@ -0,0 +1,78 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <cstddef>
+#include <vector>
+#include "allocator.h"
+
+/**
+ * per thread bump allocator for kernel scratch memory. memory is taken from one pre-faulted block and handed back
+ * when the Scope that took it ends, so after the first call of a given shape no call allocates from the heap.
+ * a request that does not fit the block is served from the heap once, and the block grows to the high-water mark
+ * when the outermost scope ends
+ */
+class Workspace {
+public:
+    /**
+     * @brief Get the workspace of the calling thread
+     */
+    static Workspace &GetThreadLocal();
+
+    /**
+     * releases every allocation made through the workspace during its lifetime, scopes nest like a stack
+     */
+    class Scope {
+    public:
+        explicit Scope(Workspace &workspace) : m_workspace(workspace), m_offset(workspace.m_offset)
+        {
+            m_workspace.m_depth++;
+        }
+        ~Scope() { m_workspace.Release(m_offset); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Workspace &m_workspace;
+        size_t m_offset;
+    };
+
+    /**
+     * @brief Take n uninitialized T aligned to CACHE_LINE_BYTES inside an open Scope, valid until that Scope ends
+     */
+    template <typename T>
+    T *Alloc(size_t n)
+    {
+        return static_cast<T *>(AllocBytes(n * sizeof(T)));
+    }
+
+    size_t GetCapacity() const { return m_block.size(); }
+    size_t GetHighWater() const { return m_highWater; }
+
+    /**
+     * @brief Get the largest high-water mark reached by any thread's workspace, in bytes
+     */
+    static size_t GetPeakHighWater();
+
+    /**
+     * @brief Get how many times any workspace went to the heap, constant in the steady state
+     */
+    static long GetHeapAllocNum();
+
+    Workspace(const Workspace &) = delete;
+    Workspace &operator=(const Workspace &) = delete;
+
+private:
+    Workspace() = default;
+    void *AllocBytes(size_t bytes);
+    void Release(size_t offset);
+
+private:
+    Buffer<char> m_block;
+    std::vector<Buffer<char>> m_overflow;
+    size_t m_offset = 0;
+    size_t m_overflowBytes = 0;
+    size_t m_highWater = 0;
+    int m_depth = 0;
+};
+
+#endif  // WORKSPACE_H
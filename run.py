@@ -1,65 +1,109 @@
 #!/usr/bin/python
 # -*- coding: UTF-8 -*-
 import argparse
+import fnmatch
 import os
+import re
 from typing import List
-from DeviceBridge import DeviceBridgeFactory
+from DeviceBridge import DeviceBridge, DeviceBridgeFactory
+
+PERF_EVENTS = ['cpu-cycles',
+               'instructions',
+               'task-clock',
+               'cpu-clock',
+               'context-switches',
+               'stalled-cycles-frontend',
+               'stalled-cycles-backend',
+               'cache-misses',
+               'cache-references',
+               'L1-dcache-loads',
+               'L1-dcache-load-misses',
+               'LLC-loads',
+               'LLC-load-misses',
+               'dTLB-loads',
+               'dTLB-load-misses',
+               'branch-misses',
+               'branch-loads',
+               'branch-load-misses',
+               'major-faults',
+               'minor-faults',
+               'page-faults']
+
 
 def get_args() -> argparse.ArgumentParser:
     parser = argparse.ArgumentParser(
         description="Run MatrixMultiplication")
+    parser.add_argument("--platform", help="run on an adb device or on this host",
+                        default="Android", choices=["Android", "Linux"])
     parser.add_argument("--size", help="size of data", default=1024)
     parser.add_argument("--debug", action="store_true", help="debug mode")
+    parser.add_argument("--kernel", help="glob pattern of the kernels to run, e.g. 'Optimize1*'")
     parser.add_argument("--check", action="store_true", help="check result")
+    parser.add_argument("--check-exact", action="store_true", help="check result against the blocked reference")
+    parser.add_argument("--threads", help="number of threads")
+    parser.add_argument("--tune", action="store_true", help="tune the packed path for this size before running")
+    parser.add_argument("--huge-pages", help="page size backing large matrices and buffers",
+                        choices=["off", "thp", "hugetlb"])
+    parser.add_argument("--prefetch", help="software prefetch distance in k steps, 0 disables it")
+    parser.add_argument("--cores", help="cores to run on: big, all or a cpu list such as 4-7")
+    parser.add_argument("--numa", help="number of NUMA nodes to spread the threads over, 0 leaves them unbound")
     args = parser.parse_args()
     return args
 
 
-def get_options(args) -> List[str]:
-    ret = []
+def get_options(args, bridge: DeviceBridge) -> List[str]:
+    ret = ['--tuning-file', f'{bridge.work_dir()}/gemm_tuning.txt']
     if args.size is not None:
-        ret.append(f'--size {args.size}')
+        ret += ['--size', str(args.size)]
     if args.check:
         ret.append('--check')
+    if args.check_exact:
+        ret.append('--check-exact')
+    if args.threads is not None:
+        ret += ['--threads', str(args.threads)]
+    if args.tune:
+        ret.append('--tune')
+    if args.huge_pages is not None:
+        ret += ['--huge-pages', str(args.huge_pages)]
+    if args.prefetch is not None:
+        ret += ['--prefetch', str(args.prefetch)]
+    if args.cores is not None:
+        ret += ['--cores', str(args.cores)]
+    if args.numa is not None:
+        ret += ['--numa', str(args.numa)]
+    return ret
+
+
+def get_kernels(bridge: DeviceBridge, binary: str) -> List[str]:
+    ret = []
+    for line in bridge.shell([binary, '--list']).splitlines():
+        match_obj = re.match(r'^\d+\s+(\S+)', line.strip())
+        if match_obj is not None:
+            ret.append(match_obj.group(1))
     return ret
 
+
 if __name__ == '__main__':
-    adb = DeviceBridgeFactory.create_device_bridge()
-    adb.version()
-    device_list = adb.devices()
+    args = get_args()
+    bridge = DeviceBridgeFactory.create_device_bridge(args.platform)
+    bridge.version()
+    device_list = bridge.devices()
     print(device_list)
     if not device_list:
         print('No device found')
         exit(1)
-    adb.set_device(device_list[0])
-    print(adb.get_device())
-    adb.push(os.path.join('output', 'MatrixMultiplication'), '/data/local/tmp/')
-    adb.shell(['chmod', '777', '/data/local/tmp/MatrixMultiplication'])
-    args = get_args()
-    options = get_options(args)
+    bridge.set_device(device_list[0])
+    print(bridge.get_device())
+    binary = f'{bridge.work_dir()}/MatrixMultiplication'
+    bridge.push(os.path.join('output', 'MatrixMultiplication'), bridge.work_dir())
+    bridge.shell(['chmod', '777', binary])
+    options = get_options(args, bridge)
     if args.debug:
-        for i in range(1, 12):
-            adb.shell(['simpleperf stat',
-                       '-e cpu-cycles',
-                       '-e instructions',
-                       '-e task-clock',
-                       '-e cpu-clock',
-                       '-e context-switches',
-                       '-e stalled-cycles-frontend',
-                       '-e stalled-cycles-backend',
-                       '-e cache-misses',
-                       '-e cache-references',
-                       '-e L1-dcache-loads',
-                       '-e L1-dcache-load-misses',
-                       '-e LLC-loads',
-                       '-e LLC-load-misses',
-                       '-e branch-misses',
-                       '-e branch-loads',
-                       '-e branch-load-misses',
-                       '-e major-faults',
-                       '-e minor-faults',
-                       '-e page-faults'] +
-                      ['/data/local/tmp/MatrixMultiplication', f'--test {i}'] + options)
+        for kernel in get_kernels(bridge, binary):
+            if args.kernel is not None and not fnmatch.fnmatchcase(kernel, args.kernel):
+                continue
+            bridge.shell(bridge.perf_stat() + [arg for event in PERF_EVENTS for arg in ['-e', event]] +
+                         [binary, '--kernel', kernel] + options)
     else:
-        adb.shell(['/data/local/tmp/MatrixMultiplication'] + options)
-    
\ No newline at end of file
+        kernel_options = ['--kernel', args.kernel] if args.kernel is not None else []
+        bridge.shell([binary] + kernel_options + options)
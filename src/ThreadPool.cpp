@@ -0,0 +1,187 @@
+#include <algorithm>
+#include "cpu_info.h"
+#include "log.h"
+#include "numa.h"
+#include "ThreadPool.h"
+
+static thread_local bool t_inPool = false;
+static thread_local int t_node = 0;
+
+ThreadPool &ThreadPool::GetInstance()
+{
+    static ThreadPool instance;
+    return instance;
+}
+
+ThreadPool::ThreadPool()
+{
+    Start(static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+void ThreadPool::SetThreadNum(int threadNum)
+{
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+    Stop();
+    Start(threadNum);
+}
+
+void ThreadPool::SetNumaNodeNum(int nodeNum)
+{
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+    int available = static_cast<int>(GetNumaNodes().size());
+    if (nodeNum > available) {
+        LOGW("Only %d NUMA nodes are available, %d requested", available, nodeNum);
+        nodeNum = available;
+    }
+    Stop();
+    m_cores.clear();
+    m_numaNodeNum = std::max(nodeNum, 0);
+    if (m_numaNodeNum > 0) {
+        t_node = BindThreadToNode(0) ? 0 : t_node;
+    } else {
+        std::vector<int> cpus;
+        for (auto &node : GetNumaNodes()) {
+            cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+        }
+        BindThreadToCpus(cpus);
+        t_node = 0;
+    }
+    Start(m_threadNum);
+}
+
+void ThreadPool::SetCores(const std::vector<int> &cores)
+{
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+    Stop();
+    m_numaNodeNum = 0;
+    m_cores = cores;
+    t_node = 0;
+    if (!m_cores.empty()) {
+        BindThreadToCpus({m_cores[0]});
+        Start(static_cast<int>(m_cores.size()));
+        return;
+    }
+    std::vector<int> cpus;
+    for (auto &core : GetCpuCores()) {
+        cpus.push_back(core.id);
+    }
+    BindThreadToCpus(cpus);
+    Start(m_threadNum);
+}
+
+int ThreadPool::GetWorkUnits() const
+{
+    long minWeight = m_weightPrefix[1];
+    for (int id = 1; id < m_threadNum; id++) {
+        minWeight = std::min(minWeight, m_weightPrefix[id + 1] - m_weightPrefix[id]);
+    }
+    return static_cast<int>((m_weightPrefix[m_threadNum] + minWeight - 1) / minWeight);
+}
+
+int ThreadPool::GetCurrentNode()
+{
+    return t_node;
+}
+
+void ThreadPool::Start(int threadNum)
+{
+    m_threadNum = std::max(threadNum, 1);
+    m_weightPrefix.assign(m_threadNum + 1, 0);
+    for (int id = 0; id < m_threadNum; id++) {
+        long weight = m_cores.empty() ? 1 : GetCpuCapacity(m_cores[id % m_cores.size()]);
+        m_weightPrefix[id + 1] = m_weightPrefix[id] + weight;
+    }
+    m_stop = false;
+    for (int id = 1; id < m_threadNum; id++) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this, id, m_generation);
+    }
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_startCv.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void ThreadPool::ParallelFor(int begin, int end, const std::function<void(int, int)> &func)
+{
+    int total = end - begin;
+    if (total <= 0) {
+        return;
+    }
+    int taskNum = std::min(total, m_threadNum);
+    if (taskNum == 1 || t_inPool) {
+        func(begin, end);
+        return;
+    }
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_func = &func;
+        m_begin = begin;
+        m_end = end;
+        m_taskNum = taskNum;
+        m_pending = taskNum - 1;
+        m_generation++;
+    }
+    m_startCv.notify_all();
+    t_inPool = true;
+    RunTask(0);
+    t_inPool = false;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCv.wait(lock, [this] { return m_pending == 0; });
+    m_func = nullptr;
+}
+
+void ThreadPool::RunTask(int id)
+{
+    long total = m_end - m_begin;
+    long weightSum = m_weightPrefix[m_taskNum];
+    int chunkBegin = m_begin + static_cast<int>(total * m_weightPrefix[id] / weightSum);
+    int chunkEnd = m_begin + static_cast<int>(total * m_weightPrefix[id + 1] / weightSum);
+    (*m_func)(chunkBegin, chunkEnd);
+}
+
+void ThreadPool::WorkerLoop(int id, unsigned long seen)
+{
+    t_inPool = true;
+    if (m_numaNodeNum > 0) {
+        int node = static_cast<int>(static_cast<long>(id) * m_numaNodeNum / m_threadNum);
+        t_node = BindThreadToNode(node) ? node : 0;
+    } else if (!m_cores.empty()) {
+        BindThreadToCpus({m_cores[id % m_cores.size()]});
+    }
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCv.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+            if (id >= m_taskNum) {
+                continue;
+            }
+        }
+        RunTask(id);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending--;
+            if (m_pending == 0) {
+                m_doneCv.notify_one();
+            }
+        }
+    }
+}
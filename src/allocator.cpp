@@ -0,0 +1,161 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "log.h"
+#include "allocator.h"
+
+/**
+ * stored in the cache line in front of every allocation so that AlignedFree needs no size
+ */
+struct AllocHeader {
+    void *base;    /**< Start of the heap block or mapping */
+    size_t length; /**< Length of the mapping, 0 for heap blocks */
+};
+
+static_assert(sizeof(AllocHeader) <= CACHE_LINE_BYTES, "the header must fit in front of the data");
+
+static std::atomic<HugePageMode> g_hugePageMode{HugePageMode::THP};
+
+void SetHugePageMode(HugePageMode mode)
+{
+    g_hugePageMode = mode;
+}
+
+HugePageMode GetHugePageMode()
+{
+    return g_hugePageMode;
+}
+
+bool ParseHugePageMode(const char *name, HugePageMode &mode)
+{
+    if (strcmp(name, "off") == 0) {
+        mode = HugePageMode::OFF;
+    } else if (strcmp(name, "thp") == 0) {
+        mode = HugePageMode::THP;
+    } else if (strcmp(name, "hugetlb") == 0) {
+        mode = HugePageMode::HUGETLB;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * map length bytes starting on a 2 MiB boundary: MAP_HUGETLB first if asked, otherwise over-map by a huge page,
+ * trim both ends and madvise the rest for transparent huge pages
+ */
+static void *MapHuge(size_t length, HugePageMode mode)
+{
+#ifdef MAP_HUGETLB
+    if (mode == HugePageMode::HUGETLB) {
+        void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            return ptr;
+        }
+        static std::atomic<bool> warned{false};
+        if (!warned.exchange(true)) {
+            LOGW("MAP_HUGETLB failed, no huge pages reserved in /proc/sys/vm/nr_hugepages? fall back to THP");
+        }
+    }
+#endif
+    void *raw = mmap(nullptr, length + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (begin + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+    size_t head = aligned - begin;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (HUGE_PAGE_BYTES - head > 0) {
+        munmap(reinterpret_cast<void *>(aligned + length), HUGE_PAGE_BYTES - head);
+    }
+#ifdef MADV_HUGEPAGE
+    if (mode != HugePageMode::OFF) {
+        madvise(reinterpret_cast<void *>(aligned), length, MADV_HUGEPAGE);
+    }
+#endif
+    return reinterpret_cast<void *>(aligned);
+}
+
+static size_t PageBytes(size_t bytes)
+{
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (bytes + pageSize - 1) / pageSize * pageSize;
+}
+
+void *AlignedAlloc(size_t bytes, AllocInit init)
+{
+    HugePageMode mode = g_hugePageMode;
+    size_t total = bytes + CACHE_LINE_BYTES;
+    AllocHeader header{};
+    char *base = nullptr;
+    if (mode != HugePageMode::OFF && total >= HUGE_PAGE_BYTES) {
+        header.length = (total + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+        header.base = MapHuge(header.length, mode);
+        base = static_cast<char *>(header.base);
+    } else if (init == AllocInit::UNTOUCHED) {
+        // anonymous pages read as zero and are only placed when first written, memset would place them all here
+        header.length = PageBytes(total);
+        void *ptr = mmap(nullptr, header.length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr != MAP_FAILED) {
+            header.base = ptr;
+            base = static_cast<char *>(ptr);
+        }
+    } else {
+        void *ptr = nullptr;
+        if (posix_memalign(&ptr, CACHE_LINE_BYTES, total) == 0) {
+            memset(ptr, 0, total);
+            header.base = ptr;
+            base = static_cast<char *>(ptr);
+        }
+    }
+    if (!base) {
+        LOGE("Failed to allocate %zu bytes", bytes);
+        return nullptr;
+    }
+    memcpy(base, &header, sizeof(header));
+    return base + CACHE_LINE_BYTES;
+}
+
+void AlignedFree(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    AllocHeader header;
+    memcpy(&header, static_cast<char *>(ptr) - CACHE_LINE_BYTES, sizeof(header));
+    if (header.length) {
+        munmap(header.base, header.length);
+    } else {
+        free(header.base);
+    }
+}
+
+void *PageAlloc(size_t bytes)
+{
+    size_t length = PageBytes(std::max<size_t>(bytes, 1));
+    void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        LOGE("Failed to map %zu bytes", bytes);
+        return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    if (g_hugePageMode != HugePageMode::OFF && length >= HUGE_PAGE_BYTES) {
+        madvise(ptr, length, MADV_HUGEPAGE);
+    }
+#endif
+    return ptr;
+}
+
+void PageFree(void *ptr, size_t bytes)
+{
+    if (ptr) {
+        munmap(ptr, PageBytes(std::max<size_t>(bytes, 1)));
+    }
+}
@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include "ThreadPool.h"
+#include "allocator.h"
+#include "kernel_registry.h"
+#include "log.h"
+#include "autotuner.h"
+
+constexpr const char *TUNING_DTYPE = "f32";
+constexpr int TUNING_REPEAT = 3;
+constexpr int TUNING_MAX_PASS = 3;
+constexpr int TUNING_MAX_BUCKET_DISTANCE = 2;
+constexpr int TUNING_MAX_BUCKET = 31;
+constexpr int TUNING_MAX_PREFETCH = 256;
+
+static const std::vector<int> MC_CANDIDATES{32, 64, 96, 128, 192, 256};
+static const std::vector<int> KC_CANDIDATES{64, 128, 192, 256, 384, 512};
+static const std::vector<int> NC_CANDIDATES{256, 512, 1024, 2048, 4096};
+static const std::vector<int> PREFETCH_CANDIDATES{0, 2, 4, 8, 16, 32};
+// the vector kernels outside the packed path that prefetch b, each in its own k steps. the scalar Optimize2, 4 and 6
+// prefetch too, but 6 distances x 4 runs of an O(n^3) scalar loop would dominate the tuning, they keep the default
+static const std::vector<std::string> PREFETCH_KERNELS{"Optimize12", "Optimize14", "Optimize16", "Optimize17",
+    "Optimize18"};
+
+static int Bucket(int x)
+{
+    int bucket = 0;
+    while ((1L << bucket) < x) {
+        bucket++;
+    }
+    return bucket;
+}
+
+template <typename F>
+static double TimeRuns(Matrix &c, F &&func)
+{
+    double best = 0.0;
+    for (int repeat = 0; repeat <= TUNING_REPEAT; repeat++) {
+        std::fill(c.data, c.data + static_cast<size_t>(c.h) * c.w, 0.0f);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        func();
+        std::chrono::duration<double> tm = std::chrono::high_resolution_clock::now() - startTime;
+        // the first run warms up caches and the thread pool
+        if (repeat == 1 || (repeat > 1 && tm.count() < best)) {
+            best = tm.count();
+        }
+    }
+    return best;
+}
+
+static double TimePacked(Matrix &a, Matrix &b, Matrix &c, const PackParams &params)
+{
+    return TimeRuns(c, [&] { PackedImpl(a, b, c, params, nullptr); });
+}
+
+/**
+ * parse a whole decimal prefetch distance in [0, TUNING_MAX_PREFETCH]
+ */
+static bool ParsePrefetch(const std::string &text, int &prefetch)
+{
+    char *end = nullptr;
+    long value = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || value < 0 || value > TUNING_MAX_PREFETCH) {
+        return false;
+    }
+    prefetch = static_cast<int>(value);
+    return true;
+}
+
+Autotuner &Autotuner::GetInstance()
+{
+    static Autotuner instance;
+    return instance;
+}
+
+Autotuner::Autotuner() : m_cpuModel(ReadCpuModel()) {}
+
+std::string Autotuner::ReadCpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    std::string hardware;
+    std::string implementer;
+    std::set<std::string> parts;
+    while (std::getline(cpuinfo, line)) {
+        size_t pos = line.find(':');
+        if (pos == std::string::npos) {
+            continue;
+        }
+        std::string name = line.substr(0, line.find_last_not_of(" \t", pos - 1) + 1);
+        std::string value = line.substr(std::min(line.find_first_not_of(" \t", pos + 1), line.size()));
+        if (name == "model name") {
+            return value;
+        } else if (name == "Hardware") {
+            hardware = value;
+        } else if (name == "CPU implementer") {
+            implementer = value;
+        } else if (name == "CPU part") {
+            parts.insert(value);
+        }
+    }
+    std::string model = hardware;
+    if (!implementer.empty()) {
+        model += (model.empty() ? "" : " ") + implementer;
+        for (auto &part : parts) {
+            model += ":" + part;
+        }
+    }
+    return model.empty() ? "unknown" : model;
+}
+
+Autotuner::TuningKey Autotuner::MakeKey(int m, int n, int k)
+{
+    return TuningKey(Bucket(m), Bucket(n), Bucket(k), TUNING_DTYPE, ThreadPool::GetInstance().GetThreadNum());
+}
+
+bool Autotuner::Load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    m_entries.clear();
+    m_foreignLines.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        std::string model;
+        std::getline(stream, model, '\t');
+        if (model != m_cpuModel) {
+            m_foreignLines.push_back(line);
+            continue;
+        }
+        TuningKey key;
+        TuningEntry entry;
+        if (!ParseEntry(stream, key, entry)) {
+            LOGW("Skip malformed tuning entry: %s", line.c_str());
+            continue;
+        }
+        m_entries[key] = entry;
+    }
+    LOGI("Loaded %zu tuning entries for %s from %s", m_entries.size(), m_cpuModel.c_str(), path.c_str());
+    return true;
+}
+
+/**
+ * parse the fields after the cpu model and reject any value the packed path or the kernels cannot run with
+ */
+bool Autotuner::ParseEntry(std::istringstream &stream, TuningKey &key, TuningEntry &entry)
+{
+    int mBucket;
+    int nBucket;
+    int kBucket;
+    std::string dtype;
+    int threads;
+    int loopOrder;
+    PackParams &params = entry.params;
+    if (!(stream >> mBucket >> nBucket >> kBucket >> dtype >> threads >> params.mc >> params.kc >> params.nc >>
+            params.mr >> params.nr >> params.unroll >> loopOrder >> entry.gflops)) {
+        return false;
+    }
+    for (int bucket : {mBucket, nBucket, kBucket}) {
+        if (bucket < 0 || bucket > TUNING_MAX_BUCKET) {
+            return false;
+        }
+    }
+    // mc and nc are whole register tiles and nc whole vectors, PackedImpl streams c blocks starting at multiples of nc
+    if (dtype != TUNING_DTYPE || threads <= 0 || params.mc <= 0 || params.kc <= 0 || params.nc <= 0 ||
+        !FindMicroKernel(params.mr, params.nr, params.unroll) || params.mc % params.mr != 0 ||
+        params.nc % params.nr != 0 || params.nc % SIMD_WIDTH != 0 ||
+        (loopOrder != static_cast<int>(LoopOrder::NKM) && loopOrder != static_cast<int>(LoopOrder::MKN)) ||
+        !std::isfinite(entry.gflops) || entry.gflops < 0.0) {
+        return false;
+    }
+    params.loopOrder = static_cast<LoopOrder>(loopOrder);
+    // the prefetch column was added after gflops, files written before keep the default distance
+    std::string token;
+    if (!(stream >> token)) {
+        params.prefetch = PackParams().prefetch;
+    } else if (!ParsePrefetch(token, params.prefetch)) {
+        return false;
+    }
+    // then one kernel=distance pair per kernel outside the packed path
+    while (stream >> token) {
+        size_t pos = token.find('=');
+        if (pos == 0 || pos == std::string::npos) {
+            return false;
+        }
+        int prefetch;
+        if (!ParsePrefetch(token.substr(pos + 1), prefetch)) {
+            return false;
+        }
+        entry.prefetch[token.substr(0, pos)] = prefetch;
+    }
+    key = TuningKey(mBucket, nBucket, kBucket, dtype, threads);
+    return true;
+}
+
+bool Autotuner::Save(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        LOGE("Failed to open tuning file %s", path.c_str());
+        return false;
+    }
+    file << "# cpu model\tm n k bucket\tdtype\tthreads\tmc kc nc\tmr nr\tunroll\tloop order\tgflops\tprefetch"
+            "\tkernel=prefetch\n";
+    for (auto &line : m_foreignLines) {
+        file << line << "\n";
+    }
+    for (auto &item : m_entries) {
+        const TuningKey &key = item.first;
+        const PackParams &params = item.second.params;
+        file << m_cpuModel << "\t" << std::get<0>(key) << " " << std::get<1>(key) << " " << std::get<2>(key) << "\t"
+             << std::get<3>(key) << "\t" << std::get<4>(key) << "\t" << params.mc << " " << params.kc << " "
+             << params.nc << "\t" << params.mr << " " << params.nr << "\t" << params.unroll << "\t"
+             << static_cast<int>(params.loopOrder) << "\t" << item.second.gflops << "\t" << params.prefetch;
+        const char *separator = "\t";
+        for (auto &kernel : item.second.prefetch) {
+            file << separator << kernel.first << "=" << kernel.second;
+            separator = " ";
+        }
+        file << "\n";
+    }
+    return file.good();
+}
+
+PackParams Autotuner::Lookup(int m, int n, int k) const
+{
+    PackParams params = LookupTuned(m, n, k);
+    if (m_prefetchDistance >= 0) {
+        params.prefetch = m_prefetchDistance;
+    }
+    return params;
+}
+
+int Autotuner::LookupPrefetch(const std::string &kernel, int m, int n, int k) const
+{
+    if (m_prefetchDistance >= 0) {
+        return m_prefetchDistance;
+    }
+    const TuningEntry *entry = FindEntry(m, n, k);
+    if (entry) {
+        auto iter = entry->prefetch.find(kernel);
+        if (iter != entry->prefetch.end()) {
+            return iter->second;
+        }
+    }
+    return PackParams().prefetch;
+}
+
+PackParams Autotuner::LookupTuned(int m, int n, int k) const
+{
+    const TuningEntry *entry = FindEntry(m, n, k);
+    return entry ? entry->params : PackParams();
+}
+
+const Autotuner::TuningEntry *Autotuner::FindEntry(int m, int n, int k) const
+{
+    TuningKey key = MakeKey(m, n, k);
+    auto iter = m_entries.find(key);
+    if (iter != m_entries.end()) {
+        return &iter->second;
+    }
+    const TuningEntry *nearest = nullptr;
+    int nearestDistance = TUNING_MAX_BUCKET_DISTANCE + 1;
+    for (auto &item : m_entries) {
+        const TuningKey &other = item.first;
+        if (std::get<3>(other) != std::get<3>(key) || std::get<4>(other) != std::get<4>(key)) {
+            continue;
+        }
+        int distance = std::abs(std::get<0>(other) - std::get<0>(key)) +
+                       std::abs(std::get<1>(other) - std::get<1>(key)) +
+                       std::abs(std::get<2>(other) - std::get<2>(key));
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearest = &item.second;
+        }
+    }
+    return nearest;
+}
+
+double Autotuner::LookupGflops(int m, int n, int k) const
+{
+    auto iter = m_entries.find(MakeKey(m, n, k));
+    return iter != m_entries.end() ? iter->second.gflops : 0.0;
+}
+
+/**
+ * round mc up to whole register tiles and nc to whole register tiles and vectors, the blocks ParseEntry accepts
+ */
+static PackParams AlignBlocks(PackParams params)
+{
+    int nAlign = std::lcm(params.nr, SIMD_WIDTH);
+    params.mc = (params.mc + params.mr - 1) / params.mr * params.mr;
+    params.nc = (params.nc + nAlign - 1) / nAlign * nAlign;
+    return params;
+}
+
+PackParams Autotuner::Tune(int m, int n, int k)
+{
+    Buffer<float> aData(static_cast<size_t>(m) * k);
+    Buffer<float> bData(static_cast<size_t>(k) * n);
+    Buffer<float> cData(static_cast<size_t>(m) * n);
+    for (size_t i = 0; i < aData.size(); i++) {
+        aData[i] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    }
+    for (size_t i = 0; i < bData.size(); i++) {
+        bData[i] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    }
+    Matrix a(aData.data(), m, k);
+    Matrix b(bData.data(), k, n);
+    Matrix c(cData.data(), m, n);
+
+    std::vector<PackParams> tiles;
+    for (auto &microKernel : GetMicroKernels()) {
+        PackParams params;
+        params.mr = microKernel.mr;
+        params.nr = microKernel.nr;
+        params.unroll = microKernel.unroll;
+        tiles.push_back(params);
+    }
+
+    PackParams best = AlignBlocks(LookupTuned(m, n, k));
+    double bestTime = TimePacked(a, b, c, best);
+    auto tryParams = [&](const PackParams &candidate) {
+        PackParams params = AlignBlocks(candidate);
+        double tm = TimePacked(a, b, c, params);
+        if (tm < bestTime) {
+            bestTime = tm;
+            best = params;
+            LOGD("mc %d kc %d nc %d mr %d nr %d unroll %d order %d prefetch %d: %f GFLOPS", params.mc, params.kc,
+                params.nc, params.mr, params.nr, params.unroll, static_cast<int>(params.loopOrder), params.prefetch,
+                2.0 * m * n * k / bestTime * 1e-9);
+            return true;
+        }
+        return false;
+    };
+    for (int pass = 0; pass < TUNING_MAX_PASS; pass++) {
+        bool improved = false;
+        for (auto &tile : tiles) {
+            PackParams params = best;
+            params.mr = tile.mr;
+            params.nr = tile.nr;
+            params.unroll = tile.unroll;
+            improved |= tryParams(params);
+        }
+        for (int mc : MC_CANDIDATES) {
+            PackParams params = best;
+            params.mc = mc;
+            improved |= tryParams(params);
+        }
+        for (int kc : KC_CANDIDATES) {
+            PackParams params = best;
+            params.kc = kc;
+            improved |= tryParams(params);
+        }
+        for (int nc : NC_CANDIDATES) {
+            PackParams params = best;
+            params.nc = nc;
+            improved |= tryParams(params);
+        }
+        for (LoopOrder loopOrder : {LoopOrder::NKM, LoopOrder::MKN}) {
+            PackParams params = best;
+            params.loopOrder = loopOrder;
+            improved |= tryParams(params);
+        }
+        for (int prefetch : PREFETCH_CANDIDATES) {
+            PackParams params = best;
+            params.prefetch = prefetch;
+            improved |= tryParams(params);
+        }
+        if (!improved) {
+            break;
+        }
+    }
+    double gflops = 2.0 * m * n * k / bestTime * 1e-9;
+    LOGI("Tuned %dx%dx%d with %d threads: mc %d kc %d nc %d mr %d nr %d unroll %d order %d prefetch %d, %f GFLOPS",
+        m, n, k, ThreadPool::GetInstance().GetThreadNum(), best.mc, best.kc, best.nc, best.mr, best.nr, best.unroll,
+        static_cast<int>(best.loopOrder), best.prefetch, gflops);
+    TuningEntry entry{best, gflops, {}};
+    TunePrefetch(a, b, c, entry);
+    m_entries[MakeKey(m, n, k)] = entry;
+    return best;
+}
+
+/**
+ * time every kernel of PREFETCH_KERNELS that runs on this shape at each prefetch candidate through the override
+ * the kernels read, and keep the fastest distance of each
+ */
+void Autotuner::TunePrefetch(Matrix &a, Matrix &b, Matrix &c, TuningEntry &entry)
+{
+    int saved = m_prefetchDistance;
+    for (auto &name : PREFETCH_KERNELS) {
+        std::vector<const KernelInfo *> kernels = KernelRegistry::GetInstance().Match(name);
+        if (kernels.size() != 1 || !KernelRegistry::IsSupported(*kernels[0], a, b, c)) {
+            continue;
+        }
+        const KernelInfo &kernel = *kernels[0];
+        double bestTime = 0.0;
+        for (int prefetch : PREFETCH_CANDIDATES) {
+            m_prefetchDistance = prefetch;
+            double tm = TimeRuns(c, [&] { kernel.func(a, b, c); });
+            if (entry.prefetch.count(name) == 0 || tm < bestTime) {
+                bestTime = tm;
+                entry.prefetch[name] = prefetch;
+            }
+        }
+        LOGI("Tuned %s prefetch %d, %f GFLOPS", name.c_str(), entry.prefetch[name],
+            2.0 * a.h * b.w * a.w / bestTime * 1e-9);
+    }
+    m_prefetchDistance = saved;
+}
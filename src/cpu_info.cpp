@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "cpu_info.h"
+
+constexpr size_t DEFAULT_LLC_BYTES = 2UL * 1024 * 1024;
+constexpr int MAX_CPU_CAPACITY = 1024;
+
+static long ReadSysfsLong(const std::string &path, long defaultValue)
+{
+    std::ifstream file(path);
+    long value = 0;
+    return file >> value ? value : defaultValue;
+}
+
+size_t GetLlcBytes()
+{
+    static size_t llcBytes = [] {
+        size_t bytes = DEFAULT_LLC_BYTES;
+        int maxLevel = 0;
+        for (int index = 0;; index++) {
+            std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(index) + "/";
+            std::ifstream levelFile(dir + "level");
+            std::ifstream sizeFile(dir + "size");
+            int level = 0;
+            size_t size = 0;
+            std::string unit;
+            if (!(levelFile >> level) || !(sizeFile >> size)) {
+                break;
+            }
+            sizeFile >> unit;
+            size *= unit == "K" ? 1024 : unit == "M" ? 1024 * 1024 : 1;
+            if (level >= maxLevel) {
+                maxLevel = level;
+                bytes = size;
+            }
+        }
+        return bytes;
+    }();
+    return llcBytes;
+}
+
+std::vector<int> ParseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        std::istringstream rangeStream(range);
+        if (!(rangeStream >> first) || first < 0) {
+            return {};
+        }
+        last = first;
+        if (rangeStream >> dash && (dash != '-' || !(rangeStream >> last) || last < first)) {
+            return {};
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+const std::vector<NumaNode> &GetNumaNodes()
+{
+    static std::vector<NumaNode> nodes = [] {
+        std::vector<NumaNode> ret;
+        std::ifstream onlineFile("/sys/devices/system/node/online");
+        std::string online;
+        onlineFile >> online;
+        for (int id : ParseCpuList(online)) {
+            std::ifstream cpuListFile("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string cpuList;
+            cpuListFile >> cpuList;
+            std::vector<int> cpus = ParseCpuList(cpuList);
+            if (!cpus.empty()) {
+                ret.push_back(NumaNode{id, cpus});
+            }
+        }
+        if (ret.empty()) {
+            NumaNode node{0, {}};
+            for (int cpu = 0; cpu < static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U)); cpu++) {
+                node.cpus.push_back(cpu);
+            }
+            ret.push_back(node);
+        }
+        return ret;
+    }();
+    return nodes;
+}
+
+const std::vector<CpuCore> &GetCpuCores()
+{
+    static std::vector<CpuCore> cores = [] {
+        std::vector<CpuCore> ret;
+        std::ifstream onlineFile("/sys/devices/system/cpu/online");
+        std::string online;
+        onlineFile >> online;
+        std::vector<int> cpus = ParseCpuList(online);
+        if (cpus.empty()) {
+            cpus = GetNumaNodes()[0].cpus;
+        }
+        bool hasCapacity = false;
+        long fastest = 0;
+        for (int cpu : cpus) {
+            std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/";
+            long capacity = ReadSysfsLong(dir + "cpu_capacity", -1);
+            long maxFreq = ReadSysfsLong(dir + "cpufreq/cpuinfo_max_freq", 0);
+            hasCapacity |= capacity > 0;
+            fastest = std::max(fastest, maxFreq);
+            ret.push_back(CpuCore{cpu, static_cast<int>(capacity), maxFreq, 0});
+        }
+        for (auto &core : ret) {
+            if (!hasCapacity) {
+                core.capacity = fastest > 0 && core.maxFreq > 0 ?
+                    static_cast<int>(core.maxFreq * MAX_CPU_CAPACITY / fastest) : MAX_CPU_CAPACITY;
+            }
+            core.capacity = std::max(core.capacity, 1);
+        }
+        std::stable_sort(ret.begin(), ret.end(),
+            [](const CpuCore &x, const CpuCore &y) { return x.capacity > y.capacity; });
+        for (size_t i = 1; i < ret.size(); i++) {
+            ret[i].cluster = ret[i - 1].cluster + (ret[i].capacity != ret[i - 1].capacity ? 1 : 0);
+        }
+        return ret;
+    }();
+    return cores;
+}
+
+int GetCpuCapacity(int cpu)
+{
+    for (auto &core : GetCpuCores()) {
+        if (core.id == cpu) {
+            return core.capacity;
+        }
+    }
+    return MAX_CPU_CAPACITY;
+}
+
+bool ParseCorePolicy(const std::string &policy, std::vector<int> &cores)
+{
+    const std::vector<CpuCore> &online = GetCpuCores();
+    cores.clear();
+    if (policy == "big" || policy == "all") {
+        for (auto &core : online) {
+            if (policy == "all" || core.cluster == online[0].cluster) {
+                cores.push_back(core.id);
+            }
+        }
+    } else {
+        for (int cpu : ParseCpuList(policy)) {
+            auto iter =
+                std::find_if(online.begin(), online.end(), [cpu](const CpuCore &core) { return core.id == cpu; });
+            if (iter != online.end()) {
+                cores.push_back(cpu);
+            }
+        }
+        std::stable_sort(cores.begin(), cores.end(),
+            [](int x, int y) { return GetCpuCapacity(x) > GetCpuCapacity(y); });
+    }
+    return !cores.empty();
+}
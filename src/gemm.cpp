@@ -8,38 +8,297 @@
 #ifdef __ARM_NEON
 #include <arm_neon.h>
 #endif
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "ThreadPool.h"
 #include "TimePerf.h"
+#include "autotuner.h"
+#include "kernel_registry.h"
 #include "log.h"
+#include "micro_kernel.h"
 #include "gemm.h"
 
 constexpr float EPSILON = 1e-5;
+constexpr float CHECK_REL_FACTOR = 4.0f;
+constexpr int REFERENCE_BLOCK_M = 16;
+constexpr int REFERENCE_BLOCK_K = 256;
 
-bool GeMM::CheckResult(Matrix &a, Matrix &b)
+static inline uint32_t UlpDistance(float x, float y)
 {
+    int32_t bitsX;
+    int32_t bitsY;
+    memcpy(&bitsX, &x, sizeof(x));
+    memcpy(&bitsY, &y, sizeof(y));
+    int64_t orderedX = bitsX < 0 ? static_cast<int64_t>(INT32_MIN) - bitsX : bitsX;
+    int64_t orderedY = bitsY < 0 ? static_cast<int64_t>(INT32_MIN) - bitsY : bitsY;
+    int64_t distance = orderedX > orderedY ? orderedX - orderedY : orderedY - orderedX;
+    return static_cast<uint32_t>(std::min<int64_t>(distance, UINT32_MAX));
+}
+
+/**
+ * compare the expected matrix a with the actual matrix b
+ * element (i, j) passes if |a - b| <= absTolerance + relTolerance * |a|, relTolerance grows with sqrt(k)
+ * because rounding errors of a k long dot product behave like a random walk.
+ * every element is visited, the returned summary holds the error statistics and the worst element
+ *
+ * @param a The expected matrix
+ * @param b The actual matrix
+ * @param k The length of the dot products that produced the matrices
+ *
+ * @return CheckSummary The error statistics
+ *
+ * @throws None
+ */
+CheckSummary GeMM::CheckResult(Matrix &a, Matrix &b, int k)
+{
+    CheckSummary summary;
     if (a.w != b.w) {
         LOGE("Matrix A's width(%d) is not equal to Matrix B's width(%d)", a.w, b.w);
-        return false;
+        return summary;
     }
     if (a.h != b.h) {
         LOGE("Matrix A's height(%d) is not equal to Matrix B's height(%d)", a.h, b.h);
-        return false;
+        return summary;
     }
     if (!a.data || !b.data) {
         LOGE("Matrix A(%p), B(%p) is null", a.data, b.data);
-        return false;
+        return summary;
     }
+    float absTolerance = EPSILON;
+    float relTolerance = CHECK_REL_FACTOR * FLT_EPSILON * std::sqrt(static_cast<float>(std::max(k, 1)));
+    double sumSquare = 0.0;
     for (int i = 0; i < a.h; i++) {
+        const float *pA = a.data + static_cast<size_t>(i) * a.w;
+        const float *pB = b.data + static_cast<size_t>(i) * b.w;
+        float rowMaxAbs = 0.0f;
+        float rowMaxRel = 0.0f;
+        uint32_t rowMaxUlp = 0;
+        float rowSumSquare = 0.0f;
+        long rowMismatch = 0;
+        int j = 0;
+        using V = VectorTraits<float>;
+        V::Type vMaxAbs = V::Zero();
+        V::Type vMaxRel = V::Zero();
+        V::Type vSumSquare = V::Zero();
+        V::UlpType vMaxUlp = V::UlpZero();
+        V::Type vTiny = V::Set(FLT_MIN);
+        V::Type vAbsTolerance = V::Set(absTolerance);
+        V::Type vRelTolerance = V::Set(relTolerance);
+        for (; j + V::WIDTH <= a.w; j += V::WIDTH) {
+            V::Type vA = V::Load(pA + j);
+            V::Type vB = V::Load(pB + j);
+            V::Type vDiff = V::Abs(V::Sub(vA, vB));
+            V::Type vAbsA = V::Abs(vA);
+            vMaxAbs = V::Max(vMaxAbs, vDiff);
+            vMaxRel = V::Max(vMaxRel, V::Div(vDiff, V::Max(vAbsA, vTiny)));
+            vSumSquare = V::MulAdd(vSumSquare, vDiff, vDiff);
+            rowMismatch += V::CountNotLessEqual(vDiff, V::MulAdd(vAbsTolerance, vRelTolerance, vAbsA));
+            vMaxUlp = V::UlpMax(vMaxUlp, vA, vB);
+        }
+        rowMaxAbs = V::ReduceMax(vMaxAbs);
+        rowMaxRel = V::ReduceMax(vMaxRel);
+        rowMaxUlp = V::ReduceUlp(vMaxUlp);
+        rowSumSquare = V::ReduceAdd(vSumSquare);
+        for (; j < a.w; j++) {
+            float diff = std::abs(pA[j] - pB[j]);
+            float absA = std::abs(pA[j]);
+            rowMaxAbs = std::max(rowMaxAbs, diff);
+            rowMaxRel = std::max(rowMaxRel, diff / std::max(absA, FLT_MIN));
+            rowSumSquare += diff * diff;
+            rowMismatch += !(diff <= absTolerance + relTolerance * absA);
+            rowMaxUlp = std::max(rowMaxUlp, UlpDistance(pA[j], pB[j]));
+        }
+        if (rowMaxAbs > summary.maxAbsError) {
+            summary.maxAbsError = rowMaxAbs;
+            summary.maxAbsRow = i;
+        }
+        if (summary.failRow < 0 && rowMismatch > 0) {
+            summary.failRow = i;
+            // the first element over the tolerance, the one closest to it if the vector count rounded differently
+            float maxExcess = 0.0f;
+            for (int col = 0; col < a.w; col++) {
+                float excess = std::abs(pA[col] - pB[col]) - (absTolerance + relTolerance * std::abs(pA[col]));
+                if (!(excess <= 0.0f)) {
+                    summary.failCol = col;
+                    break;
+                }
+                if (summary.failCol < 0 || excess > maxExcess) {
+                    summary.failCol = col;
+                    maxExcess = excess;
+                }
+            }
+        }
+        summary.maxRelError = std::max(summary.maxRelError, rowMaxRel);
+        summary.maxUlp = std::max(summary.maxUlp, rowMaxUlp);
+        summary.mismatchNum += rowMismatch;
+        sumSquare += rowSumSquare;
+    }
+    if (summary.maxAbsRow >= 0) {
+        const float *pA = a.data + static_cast<size_t>(summary.maxAbsRow) * a.w;
+        const float *pB = b.data + static_cast<size_t>(summary.maxAbsRow) * b.w;
         for (int j = 0; j < a.w; j++) {
-            if (std::abs(a.data[i * a.w + j] - b.data[i * a.w + j]) > EPSILON) {
-                LOGE("Matrix A[%d][%d]=%f is not equal to Matrix B[%d][%d]=%f", i, j, a.data[i * a.w + j], i, j,
-                    b.data[i * a.w + j]);
-                return false;
+            float diff = std::abs(pA[j] - pB[j]);
+            if (summary.maxAbsCol < 0 || diff > std::abs(pA[summary.maxAbsCol] - pB[summary.maxAbsCol])) {
+                summary.maxAbsCol = j;
             }
         }
     }
+    summary.rmsError = a.h * a.w > 0 ? std::sqrt(sumSquare / (static_cast<double>(a.h) * a.w)) : 0.0;
+    summary.absTolerance = absTolerance;
+    summary.relTolerance = relTolerance;
+    summary.passed = summary.mismatchNum == 0;
+    if (!summary.passed) {
+        int i = summary.failRow;
+        int j = summary.failCol;
+        LOGE("%ld elements out of tolerance (abs %e, rel %e), first A[%d][%d]=%f B[%d][%d]=%f, largest error %e at "
+             "[%d][%d]",
+            summary.mismatchNum, absTolerance, relTolerance, i, j, a.data[static_cast<size_t>(i) * a.w + j], i, j,
+            b.data[static_cast<size_t>(i) * b.w + j], summary.maxAbsError, summary.maxAbsRow, summary.maxAbsCol);
+    }
+    return summary;
+}
+
+/**
+ * Freivalds verification of c = a * b
+ * every round draws a random vector x and compares a * (b * x) with c * x, which costs O(n^2) instead of O(n^3).
+ * a wrong element of c survives a round only with probability ~0, several rounds guard against unlucky draws.
+ * the tolerance of row i is 4 * FLT_EPSILON * sqrt(K) * (|a| * (|b| * |x|))[i], the typical rounding growth
+ * like CheckResult, the worst case K * FLT_EPSILON would let a single element off by 5% through
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to verify
+ * @param rounds The number of random vectors
+ *
+ * @return true if every round agrees within tolerance
+ *
+ * @throws None
+ */
+bool GeMM::CheckFreivalds(Matrix &a, Matrix &b, Matrix &c, int rounds)
+{
+    if (!CheckParam(a, b, c)) {
+        return false;
+    }
+    TIMEPERF(CheckFreivalds);
+    std::mt19937_64 gen(std::random_device{}());
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<double> x(b.w);
+    std::vector<double> absX(b.w);
+    std::vector<double> bx(b.h);
+    std::vector<double> absBx(b.h);
+    ThreadPool &pool = ThreadPool::GetInstance();
+    for (int round = 0; round < rounds; round++) {
+        for (int j = 0; j < b.w; j++) {
+            x[j] = dist(gen);
+            absX[j] = std::abs(x[j]);
+        }
+        pool.ParallelFor(0, b.h, [&](int begin, int end) {
+            for (int k = begin; k < end; k++) {
+                const float *pB = b.data + static_cast<size_t>(k) * b.w;
+                double sum = 0.0;
+                double absSum = 0.0;
+                for (int j = 0; j < b.w; j++) {
+                    sum += pB[j] * x[j];
+                    absSum += std::abs(pB[j]) * absX[j];
+                }
+                bx[k] = sum;
+                absBx[k] = absSum;
+            }
+        });
+        int badRow = -1;
+        double badDiff = 0.0;
+        double badTolerance = 0.0;
+        std::mutex badMutex;
+        pool.ParallelFor(0, a.h, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                const float *pA = a.data + static_cast<size_t>(i) * a.w;
+                const float *pC = c.data + static_cast<size_t>(i) * c.w;
+                double abx = 0.0;
+                double bound = 0.0;
+                for (int k = 0; k < a.w; k++) {
+                    abx += pA[k] * bx[k];
+                    bound += std::abs(pA[k]) * absBx[k];
+                }
+                double cx = 0.0;
+                for (int j = 0; j < c.w; j++) {
+                    cx += pC[j] * x[j];
+                }
+                double diff = std::abs(abx - cx);
+                // rounding errors of a dot product grow like sqrt(k) in practice, the worst case k * eps would hide
+                // a single corrupted element, same scaling as the relative tolerance of CheckResult
+                double tolerance = 4.0 * FLT_EPSILON * std::sqrt(static_cast<double>(a.w)) * bound + EPSILON;
+                if (!(diff <= tolerance)) {
+                    std::lock_guard<std::mutex> lock(badMutex);
+                    if (badRow < 0 || i < badRow) {
+                        badRow = i;
+                        badDiff = diff;
+                        badTolerance = tolerance;
+                    }
+                }
+            }
+        });
+        if (badRow >= 0) {
+            LOGE("Freivalds round %d failed at row %d: |A(Bx) - Cx|=%e exceeds tolerance %e", round, badRow, badDiff,
+                badTolerance);
+            return false;
+        }
+    }
     return true;
 }
 
+/**
+ * reference matrix multiplication for exact diffing
+ * rows of c are split across the thread pool, k is blocked so the rows of b stay in cache,
+ * every row of c is accumulated in double before it is added to c
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Reference(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    TIMEPERF(Reference);
+    int mBlocks = (a.h + REFERENCE_BLOCK_M - 1) / REFERENCE_BLOCK_M;
+    ThreadPool::GetInstance().ParallelFor(0, mBlocks, [&](int begin, int end) {
+        std::vector<double> acc(static_cast<size_t>(REFERENCE_BLOCK_M) * b.w);
+        for (int block = begin; block < end; block++) {
+            int iBegin = block * REFERENCE_BLOCK_M;
+            int iEnd = std::min(iBegin + REFERENCE_BLOCK_M, a.h);
+            std::fill(acc.begin(), acc.end(), 0.0);
+            for (int kk = 0; kk < a.w; kk += REFERENCE_BLOCK_K) {
+                int kEnd = std::min(kk + REFERENCE_BLOCK_K, a.w);
+                for (int i = iBegin; i < iEnd; i++) {
+                    double *pAcc = acc.data() + static_cast<size_t>(i - iBegin) * b.w;
+                    for (int k = kk; k < kEnd; k++) {
+                        double a0 = a.data[static_cast<size_t>(i) * a.w + k];
+                        const float *pB = b.data + static_cast<size_t>(k) * b.w;
+                        for (int j = 0; j < b.w; j++) {
+                            pAcc[j] += a0 * pB[j];
+                        }
+                    }
+                }
+            }
+            for (int i = iBegin; i < iEnd; i++) {
+                const double *pAcc = acc.data() + static_cast<size_t>(i - iBegin) * b.w;
+                float *pC = c.data + static_cast<size_t>(i) * c.w;
+                for (int j = 0; j < c.w; j++) {
+                    pC[j] += static_cast<float>(pAcc[j]);
+                }
+            }
+        }
+    });
+}
+
 /**
  * matrix multiplication
  * i for c height, j for c width, k for a width
@@ -73,6 +332,19 @@ void GeMM::Origin(Matrix &a, Matrix &b, Matrix &c)
     }
 }
 
+/**
+ * prefetch rows [k + distance, k + distance + rows) of b, the kij loops stream a new row of b every k step
+ */
+static inline void PrefetchB(const Matrix &b, int k, int rows, int distance)
+{
+    if (distance <= 0) {
+        return;
+    }
+    for (int p = k + distance; p < std::min(k + distance + rows, b.h); p++) {
+        PrefetchRow(b.data + static_cast<size_t>(p) * b.w, b.w);
+    }
+}
+
 /**
  * matrix multiplication
  * i for c height, j for c width, k for a width
@@ -128,9 +400,11 @@ void GeMM::Optimize2(Matrix &a, Matrix &b, Matrix &c)
     float *pA = a.data;
     float *pB = b.data;
     float *pC = c.data;
+    int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize2", a.h, b.w, a.w);
     {
         TIMEPERF(Optimize2);
         for (int k = 0; k < a.w; k++) {
+            PrefetchB(b, k, 1, prefetch);
             for (int i = 0; i < a.h; i++) {
                 float a0 = pA[i * a.w + k];
                 for (int j = 0; j < b.w; j++) {
@@ -205,9 +479,11 @@ void GeMM::Optimize4(Matrix &a, Matrix &b, Matrix &c)
     float *pA = a.data;
     float *pB = b.data;
     float *pC = c.data;
+    int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize4", a.h, b.w, a.w);
     {
         TIMEPERF(Optimize4);
         for (int k = 0; k < a.w; k++) {
+            PrefetchB(b, k, 1, prefetch);
             for (int i = 0; i < a.h; i++) {
                 float a0 = pA[i * a.w + k];
                 int j = 0;
@@ -294,9 +570,11 @@ void GeMM::Optimize6(Matrix &a, Matrix &b, Matrix &c)
     float *pA = a.data;
     float *pB = b.data;
     float *pC = c.data;
+    int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize6", a.h, b.w, a.w);
     {
         TIMEPERF(Optimize6);
         for (int k = 0; k < a.w; k++) {
+            PrefetchB(b, k, 1, prefetch);
             for (int i = 0; i < a.h; i++) {
                 float a0 = pA[i * a.w + k];
 #ifdef __ARM_NEON
@@ -612,9 +890,9 @@ void GeMM::Optimize10(Matrix &a, Matrix &b, Matrix &c)
 #endif
                 for (; j < b.w; j++) {
                     pC[i * c.w + j] += a0 * pB[k * b.w + j];
-                    pC[i * c.w + j + 1] += a1 * pB[(k + 1) * b.w + j];
-                    pC[i * c.w + j + 2] += a2 * pB[(k + 2) * b.w + j];
-                    pC[i * c.w + j + 3] += a3 * pB[(k + 3) * b.w + j];
+                    pC[i * c.w + j] += a1 * pB[(k + 1) * b.w + j];
+                    pC[i * c.w + j] += a2 * pB[(k + 2) * b.w + j];
+                    pC[i * c.w + j] += a3 * pB[(k + 3) * b.w + j];
                 }
             }
         }
@@ -720,8 +998,10 @@ void GeMM::Optimize12(Matrix &a, Matrix &b, Matrix &c)
     {
         TIMEPERF(Optimize12);
 #ifdef __ARM_NEON
+        int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize12", a.h, b.w, a.w);
         int k = 0;
         for (; k < (a.w & ~3); k += 4) {
+            PrefetchB(b, k, 4, prefetch);
             for (int i = 0; i < a.h; i++) {
                 float32x4_t vA = vld1q_f32(pA + i * a.w + k);
                 float32x4_t vA0 = vdupq_laneq_f32(vA, 0);
@@ -859,6 +1139,7 @@ void GeMM::Optimize14(Matrix &a, Matrix &b, Matrix &c)
     {
         TIMEPERF(Optimize14);
 #ifdef __ARM_NEON
+        int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize14", a.h, b.w, a.w);
         int aIdx;
         int bIdx;
         int cIdx;
@@ -875,6 +1156,7 @@ void GeMM::Optimize14(Matrix &a, Matrix &b, Matrix &c)
         float32x4_t vC2;
         float32x4_t vC3;
         for (int k = 0; k < (a.w & ~3); k += 4) {
+            PrefetchB(b, k, 4, prefetch);
             for (int i = 0; i < (a.h & ~3); i += 4) {
                 aIdx = i * a.w + k;
                 vA0 = vld1q_f32(pA + aIdx);
@@ -1038,6 +1320,7 @@ void GeMM::Optimize16(Matrix &a, Matrix &b, Matrix &c)
     {
         TIMEPERF(Optimize16);
 #ifdef __ARM_NEON
+        int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize16", a.h, b.w, a.w);
         int aIdx;
         int bIdx;
         int cIdx;
@@ -1057,6 +1340,7 @@ void GeMM::Optimize16(Matrix &a, Matrix &b, Matrix &c)
         int aWAlign = a.w & ~3;
         int bWAlign = b.w & ~3;
         for (int k = 0; k < aWAlign; k += 4) {
+            PrefetchB(b, k, 4, prefetch);
             int bIdxBase = k * b.w;
             for (int i = 0; i < aHAlign; i += 4) {
                 int aIdxBase = i * a.w;
@@ -1124,3 +1408,145 @@ bool GeMM::CheckParam(Matrix &a, Matrix &b, Matrix &c)
     }
     return true;
 }
+
+/**
+ * c += a * b with MR x NR register tiles over the full k, the rows and columns left over at the bottom and
+ * right edges are done by a scalar ikj loop
+ */
+template <int MR, int NR>
+static void RegisterTile(Matrix &a, Matrix &b, Matrix &c, int prefetch)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    int mMain = m / MR * MR;
+    int nMain = n / NR * NR;
+    for (int i = 0; i < mMain; i += MR) {
+        for (int j = 0; j < nMain; j += NR) {
+            MicroKernelRowMajor<float, MR, NR>(k, a.data + i * k, k, b.data + j, n, c.data + i * n + j, n, prefetch);
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        int jBegin = i < mMain ? nMain : 0;
+        if (jBegin == n) {
+            continue;
+        }
+        for (int p = 0; p < k; p++) {
+            float valA = a.data[i * k + p];
+            for (int j = jBegin; j < n; j++) {
+                c.data[i * n + j] += valA * b.data[p * n + j];
+            }
+        }
+    }
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * for loop ij, k innermost
+ * simd j, 4x8 register tile of c kept across the full k loop
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Optimize17(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize17", a.h, b.w, a.w);
+    TIMEPERF(Optimize17);
+    RegisterTile<4, 8>(a, b, c, prefetch);
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * for loop ij, k innermost
+ * simd j, 6x16 register tile of c kept across the full k loop
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Optimize18(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    int prefetch = Autotuner::GetInstance().LookupPrefetch("Optimize18", a.h, b.w, a.w);
+    TIMEPERF(Optimize18);
+    RegisterTile<6, 16>(a, b, c, prefetch);
+}
+
+REGISTER_KERNEL(Optimize1, KernelInfo("Optimize1", "loop ikj", GeMM::Optimize1).Cost(0.5f, 1.0f));
+REGISTER_KERNEL(Optimize2, KernelInfo("Optimize2", "loop kij", GeMM::Optimize2).Cost(0.4f, 1.0f));
+REGISTER_KERNEL(Optimize3, KernelInfo("Optimize3", "loop ikj, unroll j", GeMM::Optimize3).Cost(0.55f, 1.0f));
+REGISTER_KERNEL(Optimize4, KernelInfo("Optimize4", "loop kij, unroll j", GeMM::Optimize4).Cost(0.45f, 1.0f));
+REGISTER_KERNEL(Optimize5,
+    KernelInfo("Optimize5", "loop ikj, simd j", GeMM::Optimize5).Vector(NEON_WIDTH).Cost(0.5f, 1.0f));
+REGISTER_KERNEL(Optimize6,
+    KernelInfo("Optimize6", "loop kij, simd j", GeMM::Optimize6).Vector(NEON_WIDTH).Cost(0.4f, 1.0f));
+REGISTER_KERNEL(Optimize7, KernelInfo("Optimize7", "loop ikj, unroll kj", GeMM::Optimize7).Cost(0.6f, 1.0f));
+REGISTER_KERNEL(Optimize8, KernelInfo("Optimize8", "loop kij, unroll kj", GeMM::Optimize8).Cost(0.5f, 1.0f));
+REGISTER_KERNEL(Optimize9,
+    KernelInfo("Optimize9", "loop ikj, simd kj", GeMM::Optimize9).Vector(NEON_WIDTH).Cost(0.6f, 1.0f));
+REGISTER_KERNEL(Optimize10,
+    KernelInfo("Optimize10", "loop kij, simd kj", GeMM::Optimize10).Vector(NEON_WIDTH).Cost(0.5f, 1.0f));
+REGISTER_KERNEL(Optimize11, KernelInfo("Optimize11", "loop ikj, simd kj, align 4 kj", GeMM::Optimize11)
+                                .Isa(ISA_NEON)
+                                .Align(1, 4, 4)
+                                .Vector(4)
+                                .Cost(0.65f, 1.0f));
+REGISTER_KERNEL(Optimize12, KernelInfo("Optimize12", "loop kij, simd kj, align 4 kj", GeMM::Optimize12)
+                                .Isa(ISA_NEON)
+                                .Align(1, 4, 4)
+                                .Vector(4)
+                                .Cost(0.55f, 1.0f));
+REGISTER_KERNEL(Optimize13, KernelInfo("Optimize13", "loop ikj, simd kj, 4x4 block, align 4 ikj", GeMM::Optimize13)
+                                .Isa(ISA_NEON)
+                                .Align(4, 4, 4)
+                                .SizeRange(0, 512)
+                                .Vector(4)
+                                .Cost(0.7f, 4.0f));
+REGISTER_KERNEL(Optimize14, KernelInfo("Optimize14", "loop kij, simd kj, 4x4 block, align 4 kij", GeMM::Optimize14)
+                                .Isa(ISA_NEON)
+                                .Align(4, 4, 4)
+                                .SizeRange(0, 512)
+                                .Vector(4)
+                                .Cost(0.6f, 4.0f));
+REGISTER_KERNEL(Optimize15,
+    KernelInfo("Optimize15", "loop ikj, simd kj, 4x4 block, align 4 ikj, hoisted index", GeMM::Optimize15)
+        .Isa(ISA_NEON)
+        .Align(4, 4, 4)
+        .SizeRange(0, 512)
+        .Vector(4)
+        .Cost(0.75f, 4.0f));
+REGISTER_KERNEL(Optimize16,
+    KernelInfo("Optimize16", "loop kij, simd kj, 4x4 block, align 4 kij, hoisted index", GeMM::Optimize16)
+        .Isa(ISA_NEON)
+        .Align(4, 4, 4)
+        .SizeRange(0, 512)
+        .Vector(4)
+        .Cost(0.65f, 4.0f));
+REGISTER_KERNEL(Optimize17,
+    KernelInfo("Optimize17", "loop ij, simd j, 4x8 register tile over full k", GeMM::Optimize17)
+        .SizeRange(0, 512)
+        .Vector(SIMD_WIDTH)
+        .Cost(0.8f, 6.0f));
+// the 6x16 tile spills where it does not fit the registers, measured there at 16.5 ms against 13.2 ms for
+// Optimize17 at 512, so its efficiency is scaled down from Optimize17's by that ratio
+REGISTER_KERNEL(Optimize18,
+    KernelInfo("Optimize18", "loop ij, simd j, 6x16 register tile over full k", GeMM::Optimize18)
+        .SizeRange(0, 512)
+        .Vector(SIMD_WIDTH)
+        .Cost(TileFitsRegisters(6, 16) ? 0.85f : 0.8f * 13.2f / 16.5f, 8.0f));
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "ThreadPool.h"
+#include "TimePerf.h"
+#include "autotuner.h"
+#include "cpu_info.h"
+#include "kernel_registry.h"
+#include "log.h"
+#include "gemm.h"
+
+constexpr double CORE_FMA_GFLOPS = 4.0;
+constexpr double LLC_BANDWIDTH_GBS = 50.0;
+constexpr double DRAM_BANDWIDTH_GBS = 10.0;
+constexpr double UNTUNED_EFFICIENCY = 0.8;
+
+/**
+ * analytic run time of a kernel in seconds, the larger of
+ * compute time: 2mnk flops at CORE_FMA_GFLOPS * vectorWidth * efficiency per thread,
+ *               replaced by the autotuner's measurement when the kernel is tuned, scaled by UNTUNED_EFFICIENCY
+ *               when the autotuner has no data for the shape so the tuning-free kernels win
+ * memory time:  a, b and c once plus mnk / reuse floats streamed, at LLC bandwidth while b fits in the LLC
+ *               and at DRAM bandwidth otherwise
+ */
+static double EstimateCost(const KernelInfo &info, int m, int n, int k)
+{
+    double flops = 2.0 * m * n * k;
+    double threads = info.parallel ? ThreadPool::GetInstance().GetThreadNum() : 1.0;
+    double gflops = CORE_FMA_GFLOPS * info.vectorWidth * info.efficiency * threads;
+    if (info.tuned) {
+        double measured = Autotuner::GetInstance().LookupGflops(m, n, k);
+        gflops = measured > 0.0 ? measured : gflops * UNTUNED_EFFICIENCY;
+    }
+    double computeTime = flops / (gflops * 1e9);
+    double bandwidth = 4.0 * k * n <= GetLlcBytes() ? LLC_BANDWIDTH_GBS : DRAM_BANDWIDTH_GBS;
+    double traffic = 4.0 * (static_cast<double>(m) * k + static_cast<double>(k) * n + 2.0 * m * n) +
+                     4.0 * m * n * k / info.reuse;
+    double memoryTime = traffic / (bandwidth * 1e9);
+    return std::max(computeTime, memoryTime);
+}
+
+/**
+ * pick the kernel for a shape: kernels that cannot compute the full product here (isa, alignment, tail, dtype)
+ * are dropped, kernels whose size range covers max(m, n, k) are preferred, the lowest estimated cost wins
+ */
+static const KernelInfo *SelectKernel(Matrix &a, Matrix &b, Matrix &c)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    int size = std::max({m, n, k});
+    const KernelInfo *best = nullptr;
+    bool bestInRange = false;
+    double bestCost = 0.0;
+    for (auto &info : KernelRegistry::GetInstance().GetKernels()) {
+        if (!info.autoSelect || !KernelRegistry::IsSupported(info, a, b, c)) {
+            continue;
+        }
+        bool inRange = size >= info.minSize && size <= info.maxSize;
+        double cost = EstimateCost(info, m, n, k);
+        if (!best || (inRange && !bestInRange) || (inRange == bestInRange && cost < bestCost)) {
+            best = &info;
+            bestInRange = inRange;
+            bestCost = cost;
+        }
+    }
+    if (best) {
+        LOGD("Auto selected %s for %dx%dx%d, estimated %f ms", best->name.c_str(), m, n, k, bestCost * 1e3);
+    }
+    return best;
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * the registered kernel with the lowest estimated cost for this shape
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Auto(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    const KernelInfo *info = SelectKernel(a, b, c);
+    if (!info) {
+        LOGE("No kernel supports %dx%dx%d", a.h, b.w, a.w);
+        return;
+    }
+    info->func(a, b, c);
+}
+
+REGISTER_KERNEL(Auto,
+    KernelInfo("Auto", "kernel with the lowest estimated cost for the shape", GeMM::Auto).Manual().AnyOrder());
@@ -0,0 +1,235 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <vector>
+#include "allocator.h"
+#include "autotuner.h"
+#include "log.h"
+#include "matrix_file.h"
+#include "gemm_ooc.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * a matrix file accessed block by block with pread and pwrite
+ */
+class TileFile {
+public:
+    ~TileFile()
+    {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    bool Open(const std::string &path)
+    {
+        m_fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (m_fd < 0 || fstat(m_fd, &st) != 0 || pread(m_fd, &m_header, sizeof(m_header), 0) != sizeof(m_header)) {
+            LOGE("Failed to read matrix file %s", path.c_str());
+            return false;
+        }
+        return ValidateMatrixHeader(m_header, st.st_size, path);
+    }
+
+    bool Create(const std::string &path, int h, int w)
+    {
+        m_header = MakeMatrixHeader(h, w);
+        m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        off_t length = m_header.dataOffset + static_cast<off_t>(h) * w * sizeof(float);
+        if (m_fd < 0 || pwrite(m_fd, &m_header, sizeof(m_header), 0) != sizeof(m_header) ||
+            ftruncate(m_fd, length) != 0) {
+            LOGE("Failed to create matrix file %s", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    int Rows() const { return static_cast<int>(m_header.rows); }
+    int Cols() const { return static_cast<int>(m_header.cols); }
+
+    /**
+     * @brief Read the h x w block at (row, col) into dst with a dense stride of w
+     */
+    bool ReadBlock(int row, int col, int h, int w, float *dst) const
+    {
+        for (int i = 0; i < h; i++) {
+            if (!Transfer(false, row + i, col, w, dst + static_cast<size_t>(i) * w)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Write the h x w block at (row, col) from src with a dense stride of w
+     */
+    bool WriteBlock(int row, int col, int h, int w, float *src) const
+    {
+        for (int i = 0; i < h; i++) {
+            if (!Transfer(true, row + i, col, w, src + static_cast<size_t>(i) * w)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    bool Transfer(bool write, int row, int col, int len, float *data) const
+    {
+        off_t offset = m_header.dataOffset + (static_cast<off_t>(row) * m_header.stride + col) * sizeof(float);
+        char *ptr = reinterpret_cast<char *>(data);
+        size_t left = len * sizeof(float);
+        while (left > 0) {
+            ssize_t done = write ? pwrite(m_fd, ptr, left, offset) : pread(m_fd, ptr, left, offset);
+            if (done <= 0) {
+                LOGE("Failed to %s row %d of a matrix file", write ? "write" : "read", row);
+                return false;
+            }
+            ptr += done;
+            offset += done;
+            left -= done;
+        }
+        return true;
+    }
+
+private:
+    int m_fd = -1;
+    MatrixFileHeader m_header{};
+};
+
+struct OocStep {
+    int i; /**< First row of the c block */
+    int j; /**< First column of the c block */
+    int k; /**< First column of the a block */
+};
+
+bool OutOfCoreGemm(const std::string &pathA, const std::string &pathB, const std::string &pathC, int tile,
+    OocStats &stats)
+{
+    stats = OocStats();
+    TileFile fileA;
+    TileFile fileB;
+    TileFile fileC;
+    if (!fileA.Open(pathA) || !fileB.Open(pathB)) {
+        return false;
+    }
+    int m = fileA.Rows();
+    int n = fileB.Cols();
+    int k = fileA.Cols();
+    if (k != fileB.Rows() || tile <= 0) {
+        LOGE("Cannot multiply %dx%d by %dx%d with tile %d", m, k, fileB.Rows(), n, tile);
+        return false;
+    }
+    if (!fileC.Create(pathC, m, n)) {
+        return false;
+    }
+    std::vector<OocStep> steps;
+    for (int i = 0; i < m; i += tile) {
+        for (int j = 0; j < n; j += tile) {
+            for (int p = 0; p < k; p += tile) {
+                steps.push_back(OocStep{i, j, p});
+            }
+        }
+    }
+    size_t tileSize = static_cast<size_t>(tile) * tile;
+    Buffer<float> bufA[2] = {Buffer<float>(tileSize), Buffer<float>(tileSize)};
+    Buffer<float> bufB[2] = {Buffer<float>(tileSize), Buffer<float>(tileSize)};
+    Buffer<float> bufC[2] = {Buffer<float>(tileSize), Buffer<float>(tileSize)};
+    std::atomic<bool> ioFailed{false};
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+
+    auto load = [&](OocStep step, int slot) {
+        Clock::time_point start = Clock::now();
+        int mb = std::min(tile, m - step.i);
+        int nb = std::min(tile, n - step.j);
+        int kb = std::min(tile, k - step.k);
+        if (!fileA.ReadBlock(step.i, step.k, mb, kb, bufA[slot].data()) ||
+            !fileB.ReadBlock(step.k, step.j, kb, nb, bufB[slot].data())) {
+            ioFailed = true;
+        }
+        bytesRead += (static_cast<uint64_t>(mb) * kb + static_cast<uint64_t>(kb) * nb) * sizeof(float);
+        return SecondsSince(start);
+    };
+    auto store = [&](OocStep step, int slot) {
+        Clock::time_point start = Clock::now();
+        int mb = std::min(tile, m - step.i);
+        int nb = std::min(tile, n - step.j);
+        if (!fileC.WriteBlock(step.i, step.j, mb, nb, bufC[slot].data())) {
+            ioFailed = true;
+        }
+        bytesWritten += static_cast<uint64_t>(mb) * nb * sizeof(float);
+        return SecondsSince(start);
+    };
+    auto wait = [&](std::future<double> &future) {
+        if (future.valid()) {
+            Clock::time_point start = Clock::now();
+            stats.ioSeconds += future.get();
+            stats.stallSeconds += SecondsSince(start);
+        }
+    };
+
+    Clock::time_point wallStart = Clock::now();
+    std::future<double> loading;
+    std::future<double> storing[2];
+    if (!steps.empty()) {
+        loading = std::async(std::launch::async, load, steps[0], 0);
+    }
+    int cSlot = 0;
+    for (size_t s = 0; s < steps.size() && !ioFailed; s++) {
+        const OocStep &step = steps[s];
+        int slot = s % 2;
+        wait(loading);
+        if (s + 1 < steps.size()) {
+            loading = std::async(std::launch::async, load, steps[s + 1], 1 - slot);
+        }
+        int mb = std::min(tile, m - step.i);
+        int nb = std::min(tile, n - step.j);
+        int kb = std::min(tile, k - step.k);
+        if (step.k == 0) {
+            wait(storing[cSlot]);
+            memset(bufC[cSlot].data(), 0, static_cast<size_t>(mb) * nb * sizeof(float));
+        }
+        Matrix a(bufA[slot].data(), mb, kb);
+        Matrix b(bufB[slot].data(), kb, nb);
+        Matrix c(bufC[cSlot].data(), mb, nb);
+        Clock::time_point computeStart = Clock::now();
+        PackedImpl(a, b, c, Autotuner::GetInstance().Lookup(mb, nb, kb), nullptr);
+        stats.computeSeconds += SecondsSince(computeStart);
+        stats.tileNum++;
+        if (step.k + kb == k) {
+            storing[cSlot] = std::async(std::launch::async, store, step, cSlot);
+            cSlot = 1 - cSlot;
+        }
+    }
+    wait(loading);
+    wait(storing[0]);
+    wait(storing[1]);
+    stats.wallSeconds = SecondsSince(wallStart);
+    stats.bytesRead = bytesRead;
+    stats.bytesWritten = bytesWritten;
+    return !ioFailed;
+}
+
+bool ReadMatrixFileShape(const std::string &path, int &h, int &w)
+{
+    TileFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    h = file.Rows();
+    w = file.Cols();
+    return true;
+}
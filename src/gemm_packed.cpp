@@ -0,0 +1,586 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include "ThreadPool.h"
+#include "TimePerf.h"
+#include "autotuner.h"
+#include "cpu_info.h"
+#include "kernel_registry.h"
+#include "log.h"
+#include "micro_kernel.h"
+#include "numa.h"
+#include "workspace.h"
+#include "gemm_packed.h"
+
+constexpr float ABFT_TOLERANCE = 4.0f;
+constexpr float ABFT_EPSILON = 1e-5;
+
+/**
+ * checksums of one NC wide column block of c, all of them are accumulated in double
+ * row[i] = sum_j c[i][j], col[j] = sum_i c[i][j], the abs variants sum |a| * |b| and bound the rounding error
+ */
+struct AbftChecksum {
+    std::vector<double> row;
+    std::vector<double> absRow;
+    std::vector<double> col;
+    std::vector<double> absCol;
+    std::vector<double> colSumA;
+    std::vector<double> absColSumA;
+    std::vector<double> rowSumB;
+    std::vector<double> absRowSumB;
+    std::mutex mutex;
+};
+
+/**
+ * pack a mc x kc block of a into panels of MR rows, panel element (p, ir) is stored at p * MR + ir,
+ * rows past mc are zero padded. element (i, p) of the block is at pA[i * rs + p * cs], so row and column major a
+ * are packed straight from their storage. optionally accumulates the column sums of the block for the checksum row
+ */
+static void PackA(int mc, int kc, int MR, const float *pA, size_t rs, size_t cs, float *buf, double *colSum,
+    double *absColSum)
+{
+    for (int i = 0; i < mc; i += MR) {
+        int mr = std::min(MR, mc - i);
+        for (int p = 0; p < kc; p++) {
+            for (int ir = 0; ir < MR; ir++) {
+                buf[ir] = ir < mr ? pA[(i + ir) * rs + p * cs] : 0.0f;
+            }
+            if (colSum) {
+                for (int ir = 0; ir < mr; ir++) {
+                    colSum[p] += buf[ir];
+                    absColSum[p] += std::abs(buf[ir]);
+                }
+            }
+            buf += MR;
+        }
+    }
+}
+
+/**
+ * pack a kc x nc block of b into panels of NR columns, panel element (p, jr) is stored at p * NR + jr,
+ * columns past nc are zero padded. element (p, j) of the block is at pB[p * rs + j * cs], so row and column major b
+ * are packed straight from their storage. optionally accumulates the row sums of the block for the checksum column
+ */
+static void PackB(int kc, int nc, int NR, const float *pB, size_t rs, size_t cs, float *buf, double *rowSum,
+    double *absRowSum)
+{
+    for (int j = 0; j < nc; j += NR) {
+        int nr = std::min(NR, nc - j);
+        for (int p = 0; p < kc; p++) {
+            for (int jr = 0; jr < NR; jr++) {
+                buf[jr] = jr < nr ? pB[p * rs + (j + jr) * cs] : 0.0f;
+            }
+            if (rowSum) {
+                for (int jr = 0; jr < nr; jr++) {
+                    rowSum[p] += buf[jr];
+                    absRowSum[p] += std::abs(buf[jr]);
+                }
+            }
+            buf += NR;
+        }
+    }
+}
+
+#define MICRO_KERNEL_ENTRY(MR, NR, UNROLL) {MR, NR, UNROLL, MicroKernel<float, MR, NR, UNROLL>}
+
+/**
+ * the register tiles that fit the vector registers of this build, the 8x8, 6x16 and 8x12 tiles need the
+ * 32 registers of aarch64 and spill on SSE and armv7
+ */
+static std::vector<MicroKernelInfo> BuildMicroKernels()
+{
+    static const MicroKernelInfo candidates[]{
+        MICRO_KERNEL_ENTRY(4, 4, 1),
+        MICRO_KERNEL_ENTRY(4, 4, 2),
+        MICRO_KERNEL_ENTRY(4, 4, 4),
+        MICRO_KERNEL_ENTRY(4, 4, 8),
+        MICRO_KERNEL_ENTRY(4, 8, 1),
+        MICRO_KERNEL_ENTRY(4, 8, 4),
+        MICRO_KERNEL_ENTRY(8, 8, 1),
+        MICRO_KERNEL_ENTRY(8, 8, 4),
+        MICRO_KERNEL_ENTRY(6, 16, 1),
+        MICRO_KERNEL_ENTRY(6, 16, 4),
+        MICRO_KERNEL_ENTRY(8, 12, 1),
+        MICRO_KERNEL_ENTRY(8, 12, 4),
+    };
+    std::vector<MicroKernelInfo> microKernels;
+    for (auto &microKernel : candidates) {
+        if (TileFitsRegisters(microKernel.mr, microKernel.nr)) {
+            microKernels.push_back(microKernel);
+        }
+    }
+    return microKernels;
+}
+
+const std::vector<MicroKernelInfo> &GetMicroKernels()
+{
+    static const std::vector<MicroKernelInfo> microKernels = BuildMicroKernels();
+    return microKernels;
+}
+
+const MicroKernelInfo *FindMicroKernel(int mr, int nr, int unroll)
+{
+    for (auto &microKernel : GetMicroKernels()) {
+        if (microKernel.mr == mr && microKernel.nr == nr && microKernel.unroll == unroll) {
+            return &microKernel;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * multiply the packed mc x kc block of a with the packed kc x nc block of b into c,
+ * partial tiles at the bottom and right edges go through a zeroed scratch tile and are never streamed
+ */
+static void MacroKernel(int mc, int nc, int kc, const MicroKernelInfo &microKernel, int prefetch, int store,
+    const float *bufA, const float *bufB, float *pC, int ldc)
+{
+    int MR = microKernel.mr;
+    int NR = microKernel.nr;
+    for (int j = 0; j < nc; j += NR) {
+        int nr = std::min(NR, nc - j);
+        for (int i = 0; i < mc; i += MR) {
+            int mr = std::min(MR, mc - i);
+            const float *pA = bufA + i * kc;
+            const float *pB = bufB + j * kc;
+            if (mr == MR && nr == NR) {
+                microKernel.func(kc, pA, pB, pC + i * ldc + j, ldc, prefetch, store);
+                continue;
+            }
+            float tile[PACK_TILE_MAX] = {};
+            microKernel.func(kc, pA, pB, tile, NR, prefetch, STORE_ACCUMULATE);
+            for (int ir = 0; ir < mr; ir++) {
+                for (int jr = 0; jr < nr; jr++) {
+                    float &value = pC[(i + ir) * ldc + j + jr];
+                    value = (store & STORE_OVERWRITE) ? tile[ir * NR + jr] : value + tile[ir * NR + jr];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * corrupt the requested element of c when it falls in the column block c[:, jc:jc+nc], the way a flipped bit
+ * would after the multiply. the change is larger than the element so the checksums cannot absorb it
+ */
+static void AbftInject(Matrix &c, int jc, int nc, const AbftReport &report)
+{
+    if (report.faultRow < 0 || report.faultRow >= c.h || report.faultCol < jc || report.faultCol >= jc + nc) {
+        return;
+    }
+    float &value = c.data[static_cast<size_t>(report.faultRow) * c.w + report.faultCol];
+    LOGI("ABFT injected a fault into C[%d][%d]", report.faultRow, report.faultCol);
+    value += 1.0f + std::abs(value);
+}
+
+/**
+ * compare the row and column sums of the column block c[:, jc:jc+nc] with the checksums and repair
+ * a single wrong element from its row checksum. the rounding error of each element grows like sqrt(k) times
+ * its magnitude and the errors of n summed elements add up like sqrt(n), so a row tolerates
+ * sqrt(k / n) * FLT_EPSILON * absRow
+ */
+static void AbftVerify(Matrix &c, int jc, int nc, int k, AbftChecksum &checksum, AbftReport &report)
+{
+    std::vector<double> colSum(nc, 0.0);
+    std::vector<int> badRows;
+    std::vector<int> badCols;
+    float rowScale = ABFT_TOLERANCE * FLT_EPSILON * std::sqrt(static_cast<float>(k) / nc);
+    float colScale = ABFT_TOLERANCE * FLT_EPSILON * std::sqrt(static_cast<float>(k) / c.h);
+    for (int i = 0; i < c.h; i++) {
+        const float *pC = c.data + static_cast<size_t>(i) * c.w + jc;
+        double rowSum = 0.0;
+        for (int j = 0; j < nc; j++) {
+            rowSum += pC[j];
+            colSum[j] += pC[j];
+        }
+        double residual = rowSum - checksum.row[i];
+        if (!(std::abs(residual) <= rowScale * checksum.absRow[i] + ABFT_EPSILON)) {
+            badRows.push_back(i);
+        }
+    }
+    for (int j = 0; j < nc; j++) {
+        double residual = colSum[j] - checksum.col[j];
+        if (!(std::abs(residual) <= colScale * checksum.absCol[j] + ABFT_EPSILON)) {
+            badCols.push_back(jc + j);
+        }
+    }
+    if (badRows.empty() && badCols.empty()) {
+        return;
+    }
+    report.detectedNum++;
+    if (badRows.size() != 1 || badCols.size() != 1) {
+        LOGE("ABFT detected %zu bad rows and %zu bad columns in column block %d, cannot correct", badRows.size(),
+            badCols.size(), jc);
+        return;
+    }
+    int row = badRows[0];
+    int col = badCols[0];
+    float *pC = c.data + static_cast<size_t>(row) * c.w;
+    double others = 0.0;
+    for (int j = jc; j < jc + nc; j++) {
+        others += j == col ? 0.0 : pC[j];
+    }
+    float corrected = static_cast<float>(checksum.row[row] - others);
+    LOGW("ABFT corrected C[%d][%d] from %f to %f", row, col, pC[col], corrected);
+    report.row = row;
+    report.col = col;
+    report.residual = pC[col] - corrected;
+    report.correctedNum++;
+    pC[col] = corrected;
+}
+
+/**
+ * copies of the packed b block, one per NUMA node the thread pool is bound to. copy 0 is panel itself, the pages of
+ * copy i are bound to node i so the threads of every node read b from local memory. the copies are kept across
+ * calls and only grow, each is mapped on pages of its own so binding and migrating them moves no other data
+ */
+static const std::vector<const float *> &ReplicatePanel(const float *panel, size_t size)
+{
+    static thread_local std::vector<PageBuffer<float>> t_replicas;
+    static thread_local std::vector<const float *> t_panels;
+    int nodeNum = ThreadPool::GetInstance().GetNumaNodeNum();
+    t_replicas.resize(nodeNum);
+    t_panels.assign(1, panel);
+    for (int node = 1; node < nodeNum; node++) {
+        PageBuffer<float> &replica = t_replicas[node];
+        if (replica.size() < size) {
+            replica = PageBuffer<float>(size);
+            BindMemoryToNode(replica.data(), size * sizeof(float), node);
+        }
+        memcpy(replica.data(), panel, size * sizeof(float));
+        t_panels.push_back(replica.data());
+    }
+    return t_panels;
+}
+
+/**
+ * LoopOrder::NKM, blocked matrix multiplication on packed panels (Goto's algorithm)
+ * jc over NC columns of b, pc over KC rows of b, b block packed once and shared by all threads (copied once per
+ * NUMA node when the pool spans several nodes), ic over MC rows of a split across the thread pool, each thread packs
+ * its own a block.
+ * when report is set, checksums of c are accumulated from the packed panels and verified per column block.
+ * STORE_OVERWRITE of store applies to the first pc block and STORE_STREAM to the last one
+ */
+static void PackedNKM(Matrix &a, Matrix &b, Matrix &c, const PackParams &params, const MicroKernelInfo &microKernel,
+    AbftReport *report, int store)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    int MC = params.mc;
+    int KC = params.kc;
+    int NC = params.nc;
+    int MR = microKernel.mr;
+    int NR = microKernel.nr;
+    int mBlocks = (m + MC - 1) / MC;
+    int nPanelMax = (std::min(NC, n) + NR - 1) / NR * NR;
+    Workspace::Scope scope(Workspace::GetThreadLocal());
+    float *bufB = Workspace::GetThreadLocal().Alloc<float>(static_cast<size_t>(nPanelMax) * KC);
+    AbftChecksum checksum;
+    if (report) {
+        checksum.row.resize(m);
+        checksum.absRow.resize(m);
+        checksum.col.resize(NC);
+        checksum.absCol.resize(NC);
+        checksum.colSumA.resize(KC);
+        checksum.absColSumA.resize(KC);
+        checksum.rowSumB.resize(KC);
+        checksum.absRowSumB.resize(KC);
+    }
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        if (report) {
+            std::fill(checksum.col.begin(), checksum.col.end(), 0.0);
+            std::fill(checksum.absCol.begin(), checksum.absCol.end(), 0.0);
+            for (int i = 0; i < m; i++) {
+                const float *pC = c.data + static_cast<size_t>(i) * c.w + jc;
+                double rowSum = 0.0;
+                double absRowSum = 0.0;
+                for (int j = 0; j < nc; j++) {
+                    rowSum += pC[j];
+                    absRowSum += std::abs(pC[j]);
+                    checksum.col[j] += pC[j];
+                    checksum.absCol[j] += std::abs(pC[j]);
+                }
+                checksum.row[i] = rowSum;
+                checksum.absRow[i] = absRowSum;
+            }
+        }
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            int blockStore = (pc == 0 ? store & STORE_OVERWRITE : 0) | (pc + kc == k ? store & STORE_STREAM : 0);
+            if (report) {
+                std::fill(checksum.colSumA.begin(), checksum.colSumA.end(), 0.0);
+                std::fill(checksum.absColSumA.begin(), checksum.absColSumA.end(), 0.0);
+                std::fill(checksum.rowSumB.begin(), checksum.rowSumB.end(), 0.0);
+                std::fill(checksum.absRowSumB.begin(), checksum.absRowSumB.end(), 0.0);
+            }
+            PackB(kc, nc, NR, b.Ptr(pc, jc), b.RowStride(), b.ColStride(), bufB,
+                report ? checksum.rowSumB.data() : nullptr, report ? checksum.absRowSumB.data() : nullptr);
+            const std::vector<const float *> &panelsB =
+                ReplicatePanel(bufB, static_cast<size_t>((nc + NR - 1) / NR * NR) * kc);
+            ThreadPool::GetInstance().ParallelFor(0, mBlocks, [&](int begin, int end) {
+                const float *localB = panelsB[ThreadPool::GetCurrentNode()];
+                Workspace &workspace = Workspace::GetThreadLocal();
+                Workspace::Scope scope(workspace);
+                float *bufA = workspace.Alloc<float>(static_cast<size_t>((MC + MR - 1) / MR * MR) * kc);
+                std::vector<double> colSumA(report ? kc : 0, 0.0);
+                std::vector<double> absColSumA(report ? kc : 0, 0.0);
+                for (int block = begin; block < end; block++) {
+                    int ic = block * MC;
+                    int mc = std::min(MC, m - ic);
+                    PackA(mc, kc, MR, a.Ptr(ic, pc), a.RowStride(), a.ColStride(), bufA,
+                        report ? colSumA.data() : nullptr, report ? absColSumA.data() : nullptr);
+                    MacroKernel(mc, nc, kc, microKernel, params.prefetch, blockStore, bufA, localB,
+                        c.data + static_cast<size_t>(ic) * c.w + jc, c.w);
+                    if (!report) {
+                        continue;
+                    }
+                    for (int i = 0; i < mc; i++) {
+                        const float *pA = bufA + i / MR * MR * kc + i % MR;
+                        double rowSum = 0.0;
+                        double absRowSum = 0.0;
+                        for (int p = 0; p < kc; p++) {
+                            rowSum += pA[p * MR] * checksum.rowSumB[p];
+                            absRowSum += std::abs(pA[p * MR]) * checksum.absRowSumB[p];
+                        }
+                        checksum.row[ic + i] += rowSum;
+                        checksum.absRow[ic + i] += absRowSum;
+                    }
+                }
+                if (report) {
+                    std::lock_guard<std::mutex> lock(checksum.mutex);
+                    for (int p = 0; p < kc; p++) {
+                        checksum.colSumA[p] += colSumA[p];
+                        checksum.absColSumA[p] += absColSumA[p];
+                    }
+                }
+                if (blockStore & STORE_STREAM) {
+                    StreamFence();
+                }
+            });
+            if (!report) {
+                continue;
+            }
+            for (int j = 0; j < nc; j++) {
+                const float *pB = bufB + j / NR * NR * kc + j % NR;
+                double colSum = 0.0;
+                double absColSum = 0.0;
+                for (int p = 0; p < kc; p++) {
+                    colSum += checksum.colSumA[p] * pB[p * NR];
+                    absColSum += checksum.absColSumA[p] * std::abs(pB[p * NR]);
+                }
+                checksum.col[j] += colSum;
+                checksum.absCol[j] += absColSum;
+            }
+        }
+        if (report) {
+            AbftInject(c, jc, nc, *report);
+            AbftVerify(c, jc, nc, k, checksum, *report);
+        }
+    }
+}
+
+/**
+ * LoopOrder::MKN, blocked matrix multiplication on packed panels
+ * ic over MC rows of a split across the thread pool, pc over KC, jc over NC.
+ * every thread packs its a block once per pc and its own b blocks, no synchronization between blocks.
+ * STORE_OVERWRITE of store applies to the first pc block and STORE_STREAM to the last one
+ */
+static void PackedMKN(Matrix &a, Matrix &b, Matrix &c, const PackParams &params, const MicroKernelInfo &microKernel,
+    int store)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    int MC = params.mc;
+    int KC = params.kc;
+    int NC = params.nc;
+    int MR = microKernel.mr;
+    int NR = microKernel.nr;
+    int mBlocks = (m + MC - 1) / MC;
+    ThreadPool::GetInstance().ParallelFor(0, mBlocks, [&](int begin, int end) {
+        Workspace &workspace = Workspace::GetThreadLocal();
+        Workspace::Scope scope(workspace);
+        float *bufA = workspace.Alloc<float>(static_cast<size_t>((MC + MR - 1) / MR * MR) * KC);
+        float *bufB = workspace.Alloc<float>(static_cast<size_t>((std::min(NC, n) + NR - 1) / NR * NR) * KC);
+        for (int block = begin; block < end; block++) {
+            int ic = block * MC;
+            int mc = std::min(MC, m - ic);
+            for (int pc = 0; pc < k; pc += KC) {
+                int kc = std::min(KC, k - pc);
+                int blockStore = (pc == 0 ? store & STORE_OVERWRITE : 0) | (pc + kc == k ? store & STORE_STREAM : 0);
+                PackA(mc, kc, MR, a.Ptr(ic, pc), a.RowStride(), a.ColStride(), bufA, nullptr, nullptr);
+                for (int jc = 0; jc < n; jc += NC) {
+                    int nc = std::min(NC, n - jc);
+                    PackB(kc, nc, NR, b.Ptr(pc, jc), b.RowStride(), b.ColStride(), bufB, nullptr, nullptr);
+                    MacroKernel(mc, nc, kc, microKernel, params.prefetch, blockStore, bufA, bufB,
+                        c.data + static_cast<size_t>(ic) * c.w + jc, c.w);
+                }
+            }
+        }
+        if (store & STORE_STREAM) {
+            StreamFence();
+        }
+    });
+}
+
+void PackedImpl(Matrix &a, Matrix &b, Matrix &c, const PackParams &params, AbftReport *report, int store)
+{
+    const MicroKernelInfo *microKernel = FindMicroKernel(params.mr, params.nr, params.unroll);
+    if (!microKernel || params.mc <= 0 || params.kc <= 0 || params.nc <= 0 || params.prefetch < 0) {
+        LOGW("Invalid pack params mc %d kc %d nc %d mr %d nr %d unroll %d prefetch %d, use default", params.mc,
+            params.kc, params.nc, params.mr, params.nr, params.unroll, params.prefetch);
+        PackedImpl(a, b, c, PackParams(), report, store);
+        return;
+    }
+    if (report) {
+        store = STORE_ACCUMULATE;
+    }
+    if (a.w == 0) {
+        // no k block runs, c = a * b still has to write the empty product
+        if (store & STORE_OVERWRITE) {
+            std::fill(c.data, c.data + static_cast<size_t>(c.h) * c.w, 0.0f);
+        }
+        return;
+    }
+    // every c block starts at a multiple of nc columns, it is only aligned when c, its rows and nc all are
+    if (reinterpret_cast<uintptr_t>(c.data) % (SIMD_WIDTH * sizeof(float)) != 0 || c.w % SIMD_WIDTH != 0 ||
+        params.nc % SIMD_WIDTH != 0) {
+        store &= ~STORE_STREAM;
+    }
+    // on big and little cores ParallelFor splits the MC blocks by capacity, shrink MC so there are enough blocks
+    // for the smallest core to get one and every other core its proportional share
+    PackParams sized = params;
+    int units = ThreadPool::GetInstance().GetWorkUnits();
+    if (units > ThreadPool::GetInstance().GetThreadNum()) {
+        int MR = microKernel->mr;
+        sized.mc = std::max(MR, std::min(params.mc, ((a.h + units - 1) / units + MR - 1) / MR * MR));
+    }
+    if (report || sized.loopOrder == LoopOrder::NKM) {
+        PackedNKM(a, b, c, sized, *microKernel, report, store);
+    } else {
+        PackedMKN(a, b, c, sized, *microKernel, store);
+    }
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * packed panels, block sizes, register tile and loop order from the autotuner
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Packed(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    PackParams params = Autotuner::GetInstance().Lookup(a.h, b.w, a.w);
+    TIMEPERF(Packed);
+    PackedImpl(a, b, c, params, nullptr);
+}
+
+/**
+ * matrix multiplication without accumulation, c = a * b (beta = 0)
+ * packed panels like Packed, but c is never read. a c larger than the last level cache will not be re-read soon,
+ * so its final tiles are written with non-temporal stores (stnp, movntps) that bypass the caches, which keeps the
+ * packed panels resident and saves the read for ownership of every line of c
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::PackedStream(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    PackParams params = Autotuner::GetInstance().Lookup(a.h, b.w, a.w);
+    int store = STORE_OVERWRITE;
+    if (static_cast<uint64_t>(c.h) * c.w * sizeof(float) > GetLlcBytes()) {
+        store |= STORE_STREAM;
+    }
+    TIMEPERF(PackedStream);
+    PackedImpl(a, b, c, params, nullptr, store);
+}
+
+/**
+ * matrix multiplication with algorithm based fault tolerance
+ * a is conceptually augmented with its column checksum row and b with its row checksum column,
+ * the checksum products are taken from the packed panels while they are in cache, so the extra cost is
+ * O(mk + kn + mn) next to the O(mnk) product. every NC column block of c is verified as soon as it is complete,
+ * a single wrong element per block is located by its row and column and recomputed from the row checksum
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ * @param report The detected and corrected errors, faultRow and faultCol select an element to corrupt as a test
+ *
+ * @return true if c passed verification or every error was corrected
+ *
+ * @throws None
+ */
+bool GeMM::PackedAbft(Matrix &a, Matrix &b, Matrix &c, AbftReport &report)
+{
+    AbftReport fault = report;
+    report = AbftReport();
+    report.faultRow = fault.faultRow;
+    report.faultCol = fault.faultCol;
+    if (!CheckParam(a, b, c)) {
+        return false;
+    }
+    PackParams params = Autotuner::GetInstance().Lookup(a.h, b.w, a.w);
+    TIMEPERF(PackedAbft);
+    PackedImpl(a, b, c, params, &report);
+    return report.detectedNum == report.correctedNum;
+}
+
+REGISTER_KERNEL(Packed, KernelInfo("Packed", "packed panels, autotuned blocks and register tile, multi-thread",
+                            GeMM::Packed)
+                            .SizeRange(64, INT_MAX)
+                            .Vector(SIMD_WIDTH)
+                            .Cost(0.85f, 64.0f)
+                            .Parallel()
+                            .Tuned()
+                            .AnyOrder());
+// c = a * b, the previous content of c is overwritten rather than accumulated into
+REGISTER_KERNEL(PackedStream,
+    KernelInfo("PackedStream", "packed panels, c = a * b with non-temporal stores past the LLC, multi-thread",
+        GeMM::PackedStream)
+        .SizeRange(64, INT_MAX)
+        .Vector(SIMD_WIDTH)
+        .Cost(0.85f, 64.0f)
+        .Parallel()
+        .Manual()
+        .AnyOrder());
+REGISTER_KERNEL(PackedAbft, KernelInfo("PackedAbft", "packed panels with checksum fault tolerance, multi-thread",
+                                [](Matrix &a, Matrix &b, Matrix &c) {
+                                    AbftReport report;
+                                    if (!GeMM::PackedAbft(a, b, c, report)) {
+                                        LOGE("ABFT left %d uncorrected errors",
+                                            report.detectedNum - report.correctedNum);
+                                    } else if (report.correctedNum > 0) {
+                                        LOGW("ABFT corrected %d errors", report.correctedNum);
+                                    }
+                                })
+                                .SizeRange(64, INT_MAX)
+                                .Vector(SIMD_WIDTH)
+                                .Cost(0.8f, 64.0f)
+                                .Parallel()
+                                .Manual()
+                                .AnyOrder());
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include "ThreadPool.h"
+#include "TimePerf.h"
+#include "kernel_registry.h"
+#include "micro_kernel.h"
+#include "gemm.h"
+
+constexpr int RECURSIVE_MR = 4;
+constexpr int RECURSIVE_NR = 8;
+constexpr int RECURSIVE_BASE_SIZE = 64;
+
+/**
+ * c[0:m][0:n] += a[0:m][0:k] * b[0:k][0:n] in place on strided row major blocks,
+ * 4x8 register tiles with a scalar loop over the right and bottom edges
+ */
+static void BaseCase(int m, int n, int k, const float *pA, int lda, const float *pB, int ldb, float *pC, int ldc)
+{
+    int mMain = m / RECURSIVE_MR * RECURSIVE_MR;
+    int nMain = n / RECURSIVE_NR * RECURSIVE_NR;
+    for (int i = 0; i < mMain; i += RECURSIVE_MR) {
+        for (int j = 0; j < nMain; j += RECURSIVE_NR) {
+            MicroKernelRowMajor<float, RECURSIVE_MR, RECURSIVE_NR>(k, pA + static_cast<size_t>(i) * lda, lda, pB + j,
+                ldb, pC + static_cast<size_t>(i) * ldc + j, ldc, 0);
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        int jBegin = i < mMain ? nMain : 0;
+        if (jBegin == n) {
+            continue;
+        }
+        float *rowC = pC + static_cast<size_t>(i) * ldc;
+        for (int p = 0; p < k; p++) {
+            float valA = pA[static_cast<size_t>(i) * lda + p];
+            const float *rowB = pB + static_cast<size_t>(p) * ldb;
+            for (int j = jBegin; j < n; j++) {
+                rowC[j] += valA * rowB[j];
+            }
+        }
+    }
+}
+
+/**
+ * halve the largest of m, n and k until all of them fit RECURSIVE_BASE_SIZE. the halves of m and n are rounded
+ * to whole register tiles, the two halves of k run one after the other on the same c
+ */
+static void Recurse(int m, int n, int k, const float *pA, int lda, const float *pB, int ldb, float *pC, int ldc)
+{
+    if (std::max({m, n, k}) <= RECURSIVE_BASE_SIZE) {
+        BaseCase(m, n, k, pA, lda, pB, ldb, pC, ldc);
+        return;
+    }
+    if (m >= n && m >= k) {
+        int half = (m / 2 + RECURSIVE_MR - 1) / RECURSIVE_MR * RECURSIVE_MR;
+        Recurse(half, n, k, pA, lda, pB, ldb, pC, ldc);
+        Recurse(m - half, n, k, pA + static_cast<size_t>(half) * lda, lda, pB, ldb,
+            pC + static_cast<size_t>(half) * ldc, ldc);
+    } else if (n >= k) {
+        int half = (n / 2 + RECURSIVE_NR - 1) / RECURSIVE_NR * RECURSIVE_NR;
+        Recurse(m, half, k, pA, lda, pB, ldb, pC, ldc);
+        Recurse(m, n - half, k, pA, lda, pB + half, ldb, pC + half, ldc);
+    } else {
+        int half = k / 2;
+        Recurse(m, n, half, pA, lda, pB, ldb, pC, ldc);
+        Recurse(m, n, k - half, pA + half, lda, pB + static_cast<size_t>(half) * ldb, ldb, pC, ldc);
+    }
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * cache oblivious divide and conquer: the largest of m, n and k is halved until the blocks are small, so at some
+ * depth the blocks fit every cache level without knowing its size, no tuning data needed.
+ * rows of register tiles split across the thread pool, 4x8 register tile base case
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Recursive(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    TIMEPERF(Recursive);
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    int mTiles = (m + RECURSIVE_MR - 1) / RECURSIVE_MR;
+    ThreadPool::GetInstance().ParallelFor(0, mTiles, [&](int begin, int end) {
+        int iBegin = begin * RECURSIVE_MR;
+        int iEnd = std::min(end * RECURSIVE_MR, m);
+        Recurse(iEnd - iBegin, n, k, a.data + static_cast<size_t>(iBegin) * k, k, b.data, n,
+            c.data + static_cast<size_t>(iBegin) * n, n);
+    });
+}
+
+REGISTER_KERNEL(Recursive,
+    KernelInfo("Recursive", "cache oblivious recursion on the largest of m, n, k, 4x8 register tile, multi-thread",
+        GeMM::Recursive)
+        .Vector(SIMD_WIDTH)
+        .Cost(0.7f, 32.0f)
+        .Parallel());
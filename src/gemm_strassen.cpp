@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "ThreadPool.h"
+#include "TimePerf.h"
+#include "autotuner.h"
+#include "kernel_registry.h"
+#include "log.h"
+#include "workspace.h"
+#include "gemm_packed.h"
+#include "gemm_strassen.h"
+
+static StrassenParams g_strassenParams;
+
+void SetStrassenParams(const StrassenParams &params)
+{
+    g_strassenParams = params;
+}
+
+const StrassenParams &GetStrassenParams()
+{
+    return g_strassenParams;
+}
+
+int GetStrassenLevels(int m, int n, int k, const StrassenParams &params)
+{
+    int size = std::min({m, n, k});
+    int levels = 0;
+    while (levels < params.depth && (size >> (levels + 1)) >= std::max(params.cutoff, 1)) {
+        levels++;
+    }
+    return levels;
+}
+
+/**
+ * dst = x + sign * y on h x w blocks with their own strides, rows split across the thread pool
+ */
+static void Combine(int h, int w, const float *x, int ldx, const float *y, int ldy, float sign, float *dst, int ldd)
+{
+    ThreadPool::GetInstance().ParallelFor(0, h, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const float *pX = x + static_cast<size_t>(i) * ldx;
+            const float *pY = y + static_cast<size_t>(i) * ldy;
+            float *pDst = dst + static_cast<size_t>(i) * ldd;
+            for (int j = 0; j < w; j++) {
+                pDst[j] = pX[j] + sign * pY[j];
+            }
+        }
+    });
+}
+
+/**
+ * copy the h x w block src into the top left of the hd x wd block dst and zero the rest of dst
+ */
+static void CopyPadded(int h, int w, const float *src, int lds, int hd, int wd, float *dst, int ldd)
+{
+    ThreadPool::GetInstance().ParallelFor(0, hd, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            float *pDst = dst + static_cast<size_t>(i) * ldd;
+            int copied = i < h ? w : 0;
+            if (copied > 0) {
+                memcpy(pDst, src + static_cast<size_t>(i) * lds, copied * sizeof(float));
+            }
+            std::fill(pDst + copied, pDst + wd, 0.0f);
+        }
+    });
+}
+
+/**
+ * c = a * b with the packed kernel, strided blocks are copied to dense ones in the workspace first
+ */
+static void Leaf(int m, int n, int k, const float *pA, int lda, const float *pB, int ldb, float *pC, int ldc)
+{
+    Workspace &workspace = Workspace::GetThreadLocal();
+    Workspace::Scope scope(workspace);
+    float *denseA = const_cast<float *>(pA);
+    float *denseB = const_cast<float *>(pB);
+    float *denseC = pC;
+    if (lda != k) {
+        denseA = workspace.Alloc<float>(static_cast<size_t>(m) * k);
+        CopyPadded(m, k, pA, lda, m, k, denseA, k);
+    }
+    if (ldb != n) {
+        denseB = workspace.Alloc<float>(static_cast<size_t>(k) * n);
+        CopyPadded(k, n, pB, ldb, k, n, denseB, n);
+    }
+    if (ldc != n) {
+        denseC = workspace.Alloc<float>(static_cast<size_t>(m) * n);
+    }
+    Matrix a(denseA, m, k);
+    Matrix b(denseB, k, n);
+    Matrix c(denseC, m, n);
+    PackedImpl(a, b, c, Autotuner::GetInstance().Lookup(m, n, k), nullptr, STORE_OVERWRITE);
+    if (denseC != pC) {
+        CopyPadded(m, n, denseC, n, m, n, pC, ldc);
+    }
+}
+
+/**
+ * c = a * b over levels Strassen-Winograd levels, m, n and k are multiples of 2^levels.
+ * the schedule keeps the seven products in the four quadrants of c and one temporary:
+ *   S1 = A21 + A22  S2 = S1 - A11  S3 = A11 - A21  S4 = A12 - S2
+ *   T1 = B12 - B11  T2 = B22 - T1  T3 = B22 - B12  T4 = T2 - B21
+ *   P1 = A11 B11  P2 = A12 B21  P3 = S4 B22  P4 = A22 T4  P5 = S1 T1  P6 = S2 T2  P7 = S3 T3
+ *   C11 = P1 + P2  C12 = P1 + P6 + P5 + P3  C21 = P1 + P6 + P7 - P4  C22 = P1 + P6 + P7 + P5
+ */
+static void Winograd(int m, int n, int k, const float *pA, int lda, const float *pB, int ldb, float *pC, int ldc,
+    int levels)
+{
+    if (levels == 0) {
+        Leaf(m, n, k, pA, lda, pB, ldb, pC, ldc);
+        return;
+    }
+    int m2 = m / 2;
+    int n2 = n / 2;
+    int k2 = k / 2;
+    const float *a11 = pA;
+    const float *a12 = pA + k2;
+    const float *a21 = pA + static_cast<size_t>(m2) * lda;
+    const float *a22 = a21 + k2;
+    const float *b11 = pB;
+    const float *b12 = pB + n2;
+    const float *b21 = pB + static_cast<size_t>(k2) * ldb;
+    const float *b22 = b21 + n2;
+    float *c11 = pC;
+    float *c12 = pC + n2;
+    float *c21 = pC + static_cast<size_t>(m2) * ldc;
+    float *c22 = c21 + n2;
+
+    Workspace &workspace = Workspace::GetThreadLocal();
+    Workspace::Scope scope(workspace);
+    float *x = workspace.Alloc<float>(static_cast<size_t>(m2) * k2);
+    float *y = workspace.Alloc<float>(static_cast<size_t>(k2) * n2);
+    float *p1 = workspace.Alloc<float>(static_cast<size_t>(m2) * n2);
+    auto multiply = [&](const float *lhs, int ldl, const float *rhs, int ldr, float *dst, int ldd) {
+        Winograd(m2, n2, k2, lhs, ldl, rhs, ldr, dst, ldd, levels - 1);
+    };
+
+    Combine(m2, k2, a11, lda, a21, lda, -1.0f, x, k2);     // S3
+    Combine(k2, n2, b22, ldb, b12, ldb, -1.0f, y, n2);     // T3
+    multiply(x, k2, y, n2, c21, ldc);                      // C21 = P7
+    Combine(m2, k2, a21, lda, a22, lda, 1.0f, x, k2);      // S1
+    Combine(k2, n2, b12, ldb, b11, ldb, -1.0f, y, n2);     // T1
+    multiply(x, k2, y, n2, c22, ldc);                      // C22 = P5
+    Combine(m2, k2, x, k2, a11, lda, -1.0f, x, k2);        // S2
+    Combine(k2, n2, b22, ldb, y, n2, -1.0f, y, n2);        // T2
+    multiply(x, k2, y, n2, c12, ldc);                      // C12 = P6
+    Combine(m2, k2, a12, lda, x, k2, -1.0f, x, k2);        // S4
+    multiply(x, k2, b22, ldb, c11, ldc);                   // C11 = P3
+    multiply(a11, lda, b11, ldb, p1, n2);                  // P1
+    Combine(m2, n2, p1, n2, c12, ldc, 1.0f, c12, ldc);     // C12 = P1 + P6
+    Combine(m2, n2, c12, ldc, c21, ldc, 1.0f, c21, ldc);   // C21 = P1 + P6 + P7
+    Combine(m2, n2, c12, ldc, c22, ldc, 1.0f, c12, ldc);   // C12 = P1 + P6 + P5
+    Combine(m2, n2, c12, ldc, c11, ldc, 1.0f, c12, ldc);   // C12 = P1 + P6 + P5 + P3
+    Combine(m2, n2, c21, ldc, c22, ldc, 1.0f, c22, ldc);   // C22 = P1 + P6 + P7 + P5
+    Combine(k2, n2, y, n2, b21, ldb, -1.0f, y, n2);        // T4
+    multiply(a22, lda, y, n2, c11, ldc);                   // C11 = P4
+    Combine(m2, n2, c21, ldc, c11, ldc, -1.0f, c21, ldc);  // C21 = P1 + P6 + P7 - P4
+    multiply(a12, lda, b21, ldb, c11, ldc);                // C11 = P2
+    Combine(m2, n2, p1, n2, c11, ldc, 1.0f, c11, ldc);     // C11 = P1 + P2
+}
+
+void StrassenImpl(Matrix &a, Matrix &b, Matrix &c, const StrassenParams &params)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    int levels = GetStrassenLevels(m, n, k, params);
+    int align = 1 << levels;
+    int mp = (m + align - 1) / align * align;
+    int np = (n + align - 1) / align * align;
+    int kp = (k + align - 1) / align * align;
+    if (mp == m && np == n && kp == k) {
+        Winograd(m, n, k, a.data, k, b.data, n, c.data, n, levels);
+        return;
+    }
+    Workspace &workspace = Workspace::GetThreadLocal();
+    Workspace::Scope scope(workspace);
+    float *padA = workspace.Alloc<float>(static_cast<size_t>(mp) * kp);
+    float *padB = workspace.Alloc<float>(static_cast<size_t>(kp) * np);
+    float *padC = workspace.Alloc<float>(static_cast<size_t>(mp) * np);
+    CopyPadded(m, k, a.data, k, mp, kp, padA, kp);
+    CopyPadded(k, n, b.data, n, kp, np, padB, np);
+    Winograd(mp, np, kp, padA, kp, padB, np, padC, np, levels);
+    CopyPadded(m, n, padC, np, m, n, c.data, n);
+}
+
+/**
+ * matrix multiplication without accumulation, c = a * b (beta = 0)
+ * Strassen-Winograd: every level splits a, b and c into quadrants and forms c from 7 quadrant products instead
+ * of 8, so each level saves an eighth of the flops of the level below at the cost of 15 quadrant additions and a
+ * little accuracy. levels stop at the depth and cutoff of SetStrassenParams, the quadrant products run on the
+ * packed kernel
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Strassen(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    StrassenParams params = GetStrassenParams();
+    LOGD("Strassen %dx%dx%d with %d levels", a.h, b.w, a.w, GetStrassenLevels(a.h, b.w, a.w, params));
+    TIMEPERF(Strassen);
+    StrassenImpl(a, b, c, params);
+}
+
+// c = a * b, the previous content of c is overwritten rather than accumulated into
+REGISTER_KERNEL(Strassen,
+    KernelInfo("Strassen", "Strassen-Winograd levels over packed panels, c = a * b, multi-thread", GeMM::Strassen)
+        .SizeRange(2048, INT_MAX)
+        .Vector(SIMD_WIDTH)
+        .Cost(0.85f, 64.0f)
+        .Parallel()
+        .Manual());
@@ -0,0 +1,113 @@
+#include <fnmatch.h>
+#include <algorithm>
+#include <cctype>
+#include "log.h"
+#include "kernel_registry.h"
+
+/**
+ * compare names with digit runs taken as numbers, so Optimize2 sorts before Optimize10
+ */
+static bool NaturalLess(const std::string &x, const std::string &y)
+{
+    size_t i = 0;
+    size_t j = 0;
+    while (i < x.size() && j < y.size()) {
+        if (isdigit(x[i]) && isdigit(y[j])) {
+            size_t iEnd = x.find_first_not_of("0123456789", i);
+            size_t jEnd = y.find_first_not_of("0123456789", j);
+            iEnd = iEnd == std::string::npos ? x.size() : iEnd;
+            jEnd = jEnd == std::string::npos ? y.size() : jEnd;
+            long xNum = std::stol(x.substr(i, iEnd - i));
+            long yNum = std::stol(y.substr(j, jEnd - j));
+            if (xNum != yNum) {
+                return xNum < yNum;
+            }
+            i = iEnd;
+            j = jEnd;
+            continue;
+        }
+        if (x[i] != y[j]) {
+            return x[i] < y[j];
+        }
+        i++;
+        j++;
+    }
+    return x.size() - i < y.size() - j;
+}
+
+KernelRegistry &KernelRegistry::GetInstance()
+{
+    static KernelRegistry instance;
+    return instance;
+}
+
+bool KernelRegistry::Register(const KernelInfo &info)
+{
+    if (Find(info.name)) {
+        LOGE("Kernel %s is registered twice", info.name.c_str());
+        return false;
+    }
+    auto pos = std::upper_bound(m_kernels.begin(), m_kernels.end(), info,
+        [](const KernelInfo &x, const KernelInfo &y) { return NaturalLess(x.name, y.name); });
+    m_kernels.insert(pos, info);
+    return true;
+}
+
+const KernelInfo *KernelRegistry::Find(const std::string &name) const
+{
+    for (auto &kernel : m_kernels) {
+        if (kernel.name == name) {
+            return &kernel;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<const KernelInfo *> KernelRegistry::Match(const std::string &pattern) const
+{
+    std::vector<const KernelInfo *> ret;
+    for (auto &kernel : m_kernels) {
+        if (fnmatch(pattern.c_str(), kernel.name.c_str(), 0) == 0) {
+            ret.push_back(&kernel);
+        }
+    }
+    return ret;
+}
+
+uint32_t KernelRegistry::GetHostIsa()
+{
+    uint32_t isa = ISA_NONE;
+#ifdef __ARM_NEON
+    isa |= ISA_NEON;
+#endif
+    return isa;
+}
+
+std::string KernelRegistry::IsaToString(uint32_t isa)
+{
+    std::string ret;
+    if (isa & ISA_NEON) {
+        ret += ret.empty() ? "neon" : ",neon";
+    }
+    return ret.empty() ? "none" : ret;
+}
+
+bool KernelRegistry::IsSupported(const KernelInfo &info, Matrix &a, Matrix &b, Matrix &c)
+{
+    if ((info.isa & GetHostIsa()) != info.isa || info.dtype != "f32") {
+        return false;
+    }
+    if (c.order != MatrixOrder::ROW_MAJOR ||
+        (!info.anyOrder && (a.order != MatrixOrder::ROW_MAJOR || b.order != MatrixOrder::ROW_MAJOR))) {
+        return false;
+    }
+    if (!info.tail && (a.h % info.alignM != 0 || b.w % info.alignN != 0 || a.w % info.alignK != 0)) {
+        return false;
+    }
+    for (const float *data : {a.data, b.data, c.data}) {
+        if (reinterpret_cast<uintptr_t>(data) % info.alignBytes != 0) {
+            return false;
+        }
+    }
+    return true;
+}
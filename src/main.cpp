@@ -5,49 +5,550 @@
  * @Last Modified time: 2024-02-27 00:44:13
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <random>
+#include <string>
 #include <vector>
 #include "config.h"
 #include "log.h"
+#include "ThreadPool.h"
+#include "allocator.h"
+#include "autotuner.h"
+#include "cpu_info.h"
+#include "gemm_ooc.h"
+#include "gemm_strassen.h"
+#include "kernel_registry.h"
+#include "matrix_file.h"
+#include "numa.h"
+#include "sparse.h"
+#include "transpose.h"
+#include "workspace.h"
 #include "gemm.h"
 
 static const char *helpStr = "\n " PROJECT_NAME " [OPTIONS]"
                              "\n"
                              "\n OPTIONS:"
-                             "\n  --test n                    run test n"
-                             "\n  --all-tests                 run all above tests [default]"
+                             "\n  --test n                    run Optimize n, the numbering of the original tests"
+                             "\n  --kernel pattern            run the kernels whose names match a glob pattern, e.g. 'Optimize1*'"
+                             "\n  --all-tests                 run all registered kernels [default]"
+                             "\n  --list                      list all registered kernels"
                              "\n  --size size                 size of data"
-                             "\n  --check                     check result"
+                             "\n  --input-a path              read a from a matrix file instead of random data"
+                             "\n  --input-b path              read b from a matrix file instead of random data"
+                             "\n  --output path               write c of the last kernel run to a matrix file"
+                             "\n  --layout-a order            store a row|col major, col major is also a row major buffer of a^T [default: row]"
+                             "\n  --layout-b order            store b row|col major, only kernels that read both orders run [default: row]"
+                             "\n  --save-a path               write a to a matrix file"
+                             "\n  --save-b path               write b to a matrix file"
+                             "\n  --out-of-core tile          multiply the a and b files into the output file in tile x tile blocks"
+                             "\n  --strassen-depth n          maximum Strassen-Winograd levels of the Strassen kernel [default: 2]"
+                             "\n  --strassen-cutoff n         smallest m, n or k a Strassen level splits down to [default: 512]"
+                             "\n  --strassen-report           compare Strassen at every depth with Origin for time and accuracy"
+                             "\n  --transpose-bench           measure the bandwidth of memcpy, a naive and the blocked transpose of a"
+                             "\n  --sparsity-sweep            time CSR and BSR SpMM on pruned a against dense Packed to find the crossover"
+                             "\n  --sparse24-bench            prune a to 2 of every 4 and time the 2:4 kernel against dense Packed and CSR"
+                             "\n  --sddmm-bench               time SDDMM at sparse output masks against the full dense product"
+                             "\n  --abft-inject               corrupt one element of c inside PackedAbft and check it is found and corrected"
+                             "\n  --check                     check result with Freivalds' randomized verifier"
+                             "\n  --check-inject              corrupt one element of a correct c by 5% and check Freivalds rejects it"
+                             "\n  --check-exact               check result against the blocked reference element by element"
+                             "\n  --threads n                 number of threads used by parallel code"
+                             "\n  --cores policy              run one thread per core of big|all|cpu list such as 4-7, overrides --threads"
+                             "\n  --numa n                    spread the threads over the first n NUMA nodes, 0 leaves them unbound [default: 0]"
+                             "\n  --tune                      tune the packed path for this size and save it"
+                             "\n  --huge-pages mode           back large matrices and buffers with off|thp|hugetlb pages [default: thp]"
+                             "\n  --prefetch n                software prefetch distance in k steps, 0 disables [default: tuned]"
+                             "\n  --tuning-file path          tuning file to load and save [default: " DEFAULT_TUNING_FILE "]"
                              "\n  -v, --version               display version"
                              "\n  -h, --help                  display help message"
                              "\n";
 
+/**
+ * fill data with h x w random values in [0, 1], the pages are first touched by the threads that compute their rows
+ */
+static Matrix RandomMatrix(Buffer<float> &data, int h, int w)
+{
+    data = Buffer<float>(static_cast<size_t>(h) * w, AllocInit::UNTOUCHED);
+    ParallelFirstTouch(data.data(), h, w);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    }
+    return Matrix(data.data(), h, w);
+}
+
+static Matrix LoadMatrix(MappedMatrix &file, const char *path)
+{
+    if (!file.Open(path)) {
+        exit(-1);
+    }
+    Matrix matrix = file.GetMatrix();
+    LOGI("Loaded %dx%d matrix from %s", matrix.h, matrix.w, path);
+    return matrix;
+}
+
+/**
+ * copy src into data in the given storage order, the returned matrix views data
+ */
+static Matrix ConvertOrder(const Matrix &src, Buffer<float> &data, MatrixOrder order)
+{
+    data = Buffer<float>(static_cast<size_t>(src.h) * src.w);
+    Matrix dst(data.data(), src.h, src.w, order);
+    for (int i = 0; i < src.h; i++) {
+        for (int j = 0; j < src.w; j++) {
+            *dst.Ptr(i, j) = *src.Ptr(i, j);
+        }
+    }
+    return dst;
+}
+
+static bool ParseOrder(const char *name, MatrixOrder &order)
+{
+    if (strcmp(name, "row") == 0) {
+        order = MatrixOrder::ROW_MAJOR;
+    } else if (strcmp(name, "col") == 0) {
+        order = MatrixOrder::COL_MAJOR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * multiply matrix files block by block with OutOfCoreGemm and report how much of the I/O was hidden behind compute.
+ * only the headers are read for the sizes, with checks a, b and c are mapped read only and compared like the
+ * in-memory kernels, which needs them to fit in memory
+ */
+static bool RunOutOfCore(const char *pathA, const char *pathB, const char *pathC, int tile, bool check,
+    bool checkExact)
+{
+    OocStats stats;
+    int m = 0;
+    int n = 0;
+    int k = 0;
+    if (!OutOfCoreGemm(pathA, pathB, pathC, tile, stats) || !ReadMatrixFileShape(pathA, m, k) ||
+        !ReadMatrixFileShape(pathB, k, n)) {
+        return false;
+    }
+    double gflops = 2.0 * m * n * k / stats.wallSeconds * 1e-9;
+    double hidden = stats.ioSeconds > 0.0 ? 1.0 - stats.stallSeconds / stats.ioSeconds : 1.0;
+    LOGI("Out of core %dx%dx%d with %d tiles: %f GFLOPS, wall %f s, compute %f s, io %f s, stall %f s", m, n, k,
+        tile, gflops, stats.wallSeconds, stats.computeSeconds, stats.ioSeconds, stats.stallSeconds);
+    LOGI("%ld tile products, read %llu MiB, wrote %llu MiB, %.1f%% of io overlapped with compute", stats.tileNum,
+        static_cast<unsigned long long>(stats.bytesRead >> 20),
+        static_cast<unsigned long long>(stats.bytesWritten >> 20), std::max(hidden, 0.0) * 100.0);
+    if (!check && !checkExact) {
+        return true;
+    }
+    MappedMatrix fileA;
+    MappedMatrix fileB;
+    MappedMatrix fileC;
+    if (!fileA.Open(pathA) || !fileB.Open(pathB) || !fileC.Open(pathC)) {
+        return false;
+    }
+    Matrix a = fileA.GetMatrix();
+    Matrix b = fileB.GetMatrix();
+    Matrix c = fileC.GetMatrix();
+    bool passed = true;
+    if (check) {
+        passed = GeMM::CheckFreivalds(a, b, c);
+    }
+    if (passed && checkExact) {
+        Buffer<float> referenceData(static_cast<size_t>(a.h) * b.w);
+        Matrix reference{referenceData.data(), a.h, b.w};
+        GeMM::Reference(a, b, reference);
+        CheckSummary summary = GeMM::CheckResult(reference, c, a.w);
+        LOGI("OutOfCore max abs error %e, max rel error %e, max ulp %u, rms error %e", summary.maxAbsError,
+            summary.maxRelError, summary.maxUlp, summary.rmsError);
+        passed = summary.passed;
+    }
+    if (passed) {
+        LOGI("OutOfCore passed!");
+    } else {
+        LOGE("OutOfCore failed!");
+    }
+    return passed;
+}
+
+/**
+ * time Strassen at every depth up to the configured one and compare each result with Origin, so the flops saved
+ * can be weighed against the accuracy lost
+ */
+static void RunStrassenReport(Matrix &a, Matrix &b)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    Buffer<float> originData(static_cast<size_t>(m) * n);
+    Buffer<float> outputData(static_cast<size_t>(m) * n);
+    Matrix origin(originData.data(), m, n);
+    Matrix output(outputData.data(), m, n);
+    GeMM::Origin(a, b, origin);
+    StrassenParams params = GetStrassenParams();
+    for (int depth = 0; depth <= params.depth; depth++) {
+        StrassenParams levelParams = params;
+        levelParams.depth = depth;
+        int levels = GetStrassenLevels(m, n, k, levelParams);
+        if (depth > 0 && levels < depth) {
+            LOGI("Strassen depth %d: %dx%dx%d is below cutoff %d", depth, m, n, k, params.cutoff);
+            break;
+        }
+        StrassenImpl(a, b, output, levelParams);
+        auto startTime = std::chrono::steady_clock::now();
+        StrassenImpl(a, b, output, levelParams);
+        std::chrono::duration<double> tm = std::chrono::steady_clock::now() - startTime;
+        CheckSummary summary = GeMM::CheckResult(origin, output, k);
+        LOGI("Strassen depth %d: %f ms, %f effective GFLOPS, max abs error %e, max rel error %e, max ulp %u, "
+             "rms error %e", depth, tm.count() * 1e3, 2.0 * m * n * k / tm.count() * 1e-9, summary.maxAbsError,
+            summary.maxRelError, summary.maxUlp, summary.rmsError);
+    }
+}
+
+constexpr int BENCH_REPEAT = 5;
+
+/**
+ * best of BENCH_REPEAT runs of func in seconds, the first run warms up caches and the thread pool
+ */
+template <typename F>
+static double BestTime(F &&func)
+{
+    func();
+    double best = 0.0;
+    for (int repeat = 0; repeat < BENCH_REPEAT; repeat++) {
+        auto startTime = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> tm = std::chrono::steady_clock::now() - startTime;
+        best = repeat == 0 ? tm.count() : std::min(best, tm.count());
+    }
+    return best;
+}
+
+/**
+ * median of BENCH_REPEAT runs of each func in seconds, the funcs run in turn so that frequency and cache drift hit
+ * all of them alike, the first round warms up
+ */
+static std::vector<double> InterleavedMedianTimes(const std::vector<std::function<void()>> &funcs)
+{
+    std::vector<std::vector<double>> times(funcs.size());
+    for (auto &func : funcs) {
+        func();
+    }
+    for (int repeat = 0; repeat < BENCH_REPEAT; repeat++) {
+        for (size_t i = 0; i < funcs.size(); i++) {
+            auto startTime = std::chrono::steady_clock::now();
+            funcs[i]();
+            std::chrono::duration<double> tm = std::chrono::steady_clock::now() - startTime;
+            times[i].push_back(tm.count());
+        }
+    }
+    std::vector<double> medians;
+    for (auto &funcTimes : times) {
+        std::nth_element(funcTimes.begin(), funcTimes.begin() + BENCH_REPEAT / 2, funcTimes.end());
+        medians.push_back(funcTimes[BENCH_REPEAT / 2]);
+    }
+    return medians;
+}
+
+/**
+ * transpose a with memcpy as the bandwidth bound, a naive loop, the blocked transpose and, for square a, the
+ * in-place transpose, and report the bandwidth of each as bytes read plus bytes written per second
+ */
+static void RunTransposeBench(Matrix &a)
+{
+    size_t count = static_cast<size_t>(a.h) * a.w;
+    double bytes = 2.0 * count * sizeof(float);
+    Buffer<float> expectData(count);
+    Buffer<float> outputData(count);
+    Matrix expect(expectData.data(), a.w, a.h);
+    Matrix output(outputData.data(), a.w, a.h);
+    auto report = [&](const char *name, double seconds, bool passed) {
+        LOGI("%s %dx%d: %f ms, %f GB/s%s", name, a.h, a.w, seconds * 1e3, bytes / seconds * 1e-9,
+            passed ? "" : ", wrong result");
+    };
+    report("memcpy", BestTime([&] { memcpy(output.data, a.data, count * sizeof(float)); }), true);
+    report("Naive transpose", BestTime([&] {
+        for (int i = 0; i < a.h; i++) {
+            for (int j = 0; j < a.w; j++) {
+                expect.data[static_cast<size_t>(j) * a.h + i] = a.data[static_cast<size_t>(i) * a.w + j];
+            }
+        }
+    }), true);
+    double seconds = BestTime([&] { Transpose(a, output); });
+    report("Blocked transpose", seconds, memcmp(output.data, expect.data, count * sizeof(float)) == 0);
+    if (a.h == a.w) {
+        memcpy(output.data, a.data, count * sizeof(float));
+        // an even number of runs leaves a again
+        seconds = BestTime([&] { TransposeInPlace(output.data, a.h, a.w); });
+        TransposeInPlace(output.data, a.h, a.w);
+        report("In-place transpose", seconds, memcmp(output.data, expect.data, count * sizeof(float)) == 0);
+    }
+}
+
+/**
+ * copy a into data with each element, or each BSR_BLOCK x BSR_BLOCK block when blocks is set, zeroed with
+ * probability sparsity
+ */
+static Matrix PruneMatrix(const Matrix &a, Buffer<float> &data, double sparsity, bool blocks)
+{
+    data = Buffer<float>(static_cast<size_t>(a.h) * a.w);
+    memcpy(data.data(), a.data, data.size() * sizeof(float));
+    int grain = blocks ? BSR_BLOCK : 1;
+    for (int i = 0; i < a.h; i += grain) {
+        for (int j = 0; j < a.w; j += grain) {
+            if (static_cast<double>(rand()) / RAND_MAX >= sparsity) {
+                continue;
+            }
+            for (int ii = i; ii < std::min(i + grain, a.h); ii++) {
+                std::fill(data.data() + static_cast<size_t>(ii) * a.w + j,
+                    data.data() + static_cast<size_t>(ii) * a.w + std::min(j + grain, a.w), 0.0f);
+            }
+        }
+    }
+    return Matrix(data.data(), a.h, a.w);
+}
+
+/**
+ * time the CSR kernel on a pruned element by element and the BSR kernel on a pruned block by block against
+ * dense Packed over a range of sparsities, check both against Packed on the same pruned a. dense is timed again
+ * at every sparsity, interleaved with the two sparse kernels, and each point compares medians. report the lowest
+ * sparsity from which each sparse format beats dense by CROSSOVER_MARGIN at that and every higher sparsity, so a
+ * single run that wins by noise does not move the crossover
+ */
+constexpr double CROSSOVER_MARGIN = 0.05;
+
+static void RunSparsitySweep(Matrix &a, Matrix &b)
+{
+    static const double SPARSITIES[] = {0.0, 0.25, 0.5, 0.75, 0.9, 0.95, 0.98, 0.99, 0.995, 0.999};
+    int m = a.h;
+    int n = b.w;
+    Buffer<float> expectData(static_cast<size_t>(m) * n);
+    Buffer<float> outputData(static_cast<size_t>(m) * n);
+    Matrix expect(expectData.data(), m, n);
+    Matrix output(outputData.data(), m, n);
+    size_t outputBytes = static_cast<size_t>(m) * n * sizeof(float);
+    LOGI("Dense Packed %dx%dx%d against CSR and BSR, medians of %d interleaved runs", m, n, a.w, BENCH_REPEAT);
+    // whether the result matched dense on the same pruned a
+    auto verify = [&](Matrix &pruned, auto &sparse) {
+        memset(expect.data, 0, outputBytes);
+        GeMM::Packed(pruned, b, expect);
+        memset(output.data, 0, outputBytes);
+        SpMM(sparse, b, output);
+        return GeMM::CheckResult(expect, output, a.w).passed;
+    };
+    double csrCrossover = -1.0;
+    double bsrCrossover = -1.0;
+    for (double sparsity : SPARSITIES) {
+        Buffer<float> prunedData;
+        Matrix pruned = PruneMatrix(a, prunedData, sparsity, false);
+        CsrMatrix csr(pruned);
+        bool passed = verify(pruned, csr);
+        pruned = PruneMatrix(a, prunedData, sparsity, true);
+        BsrMatrix bsr(pruned);
+        passed = verify(pruned, bsr) && passed;
+        std::vector<double> times = InterleavedMedianTimes({[&] { GeMM::Packed(a, b, output); },
+            [&] { SpMM(csr, b, output); }, [&] { SpMM(bsr, b, output); }});
+        double denseTime = times[0];
+        double csrTime = times[1];
+        double bsrTime = times[2];
+        LOGI("Sparsity %.1f%%: dense %f ms, CSR %f ms %.2fx, BSR %f ms %.2fx of dense%s", sparsity * 100.0,
+            denseTime * 1e3, csrTime * 1e3, denseTime / csrTime, bsrTime * 1e3, denseTime / bsrTime,
+            passed ? "" : ", wrong result");
+        // the sparsities ascend, a sparsity that does not win restarts the search
+        auto update = [&](double &crossover, double time) {
+            if (time * (1.0 + CROSSOVER_MARGIN) > denseTime) {
+                crossover = -1.0;
+            } else if (crossover < 0.0) {
+                crossover = sparsity;
+            }
+        };
+        update(csrCrossover, csrTime);
+        update(bsrCrossover, bsrTime);
+    }
+    auto reportCrossover = [](const char *name, double sparsity) {
+        if (sparsity < 0.0) {
+            LOGI("%s does not beat dense by %.0f%% up to the highest sparsity", name, CROSSOVER_MARGIN * 100.0);
+        } else {
+            LOGI("%s beats dense by %.0f%% from %.1f%% sparsity on", name, CROSSOVER_MARGIN * 100.0, sparsity * 100.0);
+        }
+    };
+    reportCrossover("CSR", csrCrossover);
+    reportCrossover("BSR", bsrCrossover);
+}
+
+/**
+ * prune a to the 2:4 pattern and time the 2:4 kernel against dense Packed and CSR on the same pruned a,
+ * the 2:4 result is checked against Packed
+ */
+static void RunSparse24Bench(Matrix &a, Matrix &b)
+{
+    int m = a.h;
+    int n = b.w;
+    Sparse24Matrix sparse(a);
+    Buffer<float> prunedData(static_cast<size_t>(m) * a.w);
+    Matrix pruned(prunedData.data(), m, a.w);
+    sparse.ToDense(pruned);
+    CsrMatrix csr(pruned);
+    Buffer<float> expectData(static_cast<size_t>(m) * n);
+    Buffer<float> outputData(static_cast<size_t>(m) * n);
+    Matrix expect(expectData.data(), m, n);
+    Matrix output(outputData.data(), m, n);
+    GeMM::Packed(pruned, b, expect);
+    SpMM(sparse, b, output);
+    CheckSummary summary = GeMM::CheckResult(expect, output, a.w);
+    double denseTime = BestTime([&] { GeMM::Packed(pruned, b, output); });
+    double csrTime = BestTime([&] { SpMM(csr, b, output); });
+    double sparseTime = BestTime([&] { SpMM(sparse, b, output); });
+    double flops = 2.0 * m * n * a.w;
+    LOGI("Dense Packed %dx%dx%d: %f ms, %f GFLOPS", m, n, a.w, denseTime * 1e3, flops / denseTime * 1e-9);
+    LOGI("CSR: %f ms, %.2fx of dense", csrTime * 1e3, denseTime / csrTime);
+    LOGI("2:4: %f ms, %.2fx of dense, %f effective GFLOPS, max abs error %e%s", sparseTime * 1e3,
+        denseTime / sparseTime, flops / sparseTime * 1e-9, summary.maxAbsError,
+        summary.passed ? "" : ", wrong result");
+}
+
+/**
+ * time SDDMM at masks of several densities against the full dense product with Packed, for a row major b that is
+ * transposed on every call and for a column major b, and check the sampled values against the dense product.
+ * the transpose of b is timed on its own since the row major times pay it on every call
+ */
+static void RunSddmmBench(Matrix &a, Matrix &b)
+{
+    static const double DENSITIES[] = {0.01, 0.05, 0.1, 0.25, 0.5};
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    Buffer<float> denseData(static_cast<size_t>(m) * n);
+    Buffer<float> outputData(static_cast<size_t>(m) * n);
+    Matrix dense(denseData.data(), m, n);
+    Matrix output(outputData.data(), m, n);
+    GeMM::Packed(a, b, dense);
+    double denseTime = BestTime([&] { GeMM::Packed(a, b, output); });
+    LOGI("Dense Packed %dx%dx%d: %f ms", m, n, k, denseTime * 1e3);
+    Buffer<float> btData(static_cast<size_t>(n) * k);
+    double transposeTime = BestTime([&] { Transpose(b.data, k, n, n, btData.data(), k); });
+    LOGI("Row major b is transposed on every SDDMM call: %f ms per call", transposeTime * 1e3);
+    Matrix bt(btData.data(), k, n, MatrixOrder::COL_MAJOR);
+    for (double density : DENSITIES) {
+        // the mask keeps the dense product at its nonzeros, which are the expected outputs
+        Buffer<float> maskData;
+        Matrix maskDense = PruneMatrix(dense, maskData, 1.0 - density, false);
+        CsrMatrix mask(maskDense);
+        int nnz = mask.GetNonZeroNum();
+        Buffer<float> expectData(std::max(nnz, 1));
+        Buffer<float> valuesData(std::max(nnz, 1));
+        std::copy(mask.GetValues(), mask.GetValues() + nnz, expectData.data());
+        Matrix expect(expectData.data(), 1, nnz);
+        Matrix values(valuesData.data(), 1, nnz);
+        SDDMM(a, b, mask, values.data);
+        bool passed = GeMM::CheckResult(expect, values, k).passed;
+        double rowTime = BestTime([&] { SDDMM(a, b, mask, values.data); });
+        double colTime = BestTime([&] { SDDMM(a, bt, mask, values.data); });
+        passed = passed && GeMM::CheckResult(expect, values, k).passed;
+        LOGI("Density %.1f%%, %d outputs: row major b %f ms %.2fx, column major b %f ms %.2fx of dense%s",
+            density * 100.0, nnz, rowTime * 1e3, denseTime / rowTime, colTime * 1e3, denseTime / colTime,
+            passed ? "" : ", wrong result");
+    }
+}
+
+/**
+ * corrupt one element of c between the multiply and the verify of PackedAbft, the fault must be detected once,
+ * corrected once and leave a c that passes the check against the reference
+ */
+static bool RunAbftInject(Matrix &a, Matrix &b)
+{
+    int m = a.h;
+    int n = b.w;
+    int k = a.w;
+    Buffer<float> referenceData(static_cast<size_t>(m) * n);
+    Buffer<float> outputData(static_cast<size_t>(m) * n);
+    Matrix reference(referenceData.data(), m, n);
+    Matrix output(outputData.data(), m, n);
+    GeMM::Reference(a, b, reference);
+    AbftReport report;
+    report.faultRow = m / 3;
+    report.faultCol = n / 2;
+    bool corrected = GeMM::PackedAbft(a, b, output, report);
+    CheckSummary summary = GeMM::CheckResult(reference, output, k);
+    bool passed = corrected && report.detectedNum == 1 && report.correctedNum == 1 && report.row == m / 3 &&
+        report.col == n / 2 && summary.passed;
+    if (passed) {
+        LOGI("ABFT inject passed! C[%d][%d] corrected by %e, max ulp %u", report.row, report.col, report.residual,
+            summary.maxUlp);
+    } else {
+        LOGE("ABFT inject failed! detected %d, corrected %d at C[%d][%d], max abs error %e", report.detectedNum,
+            report.correctedNum, report.row, report.col, summary.maxAbsError);
+    }
+    return passed;
+}
+
+/**
+ * make sure the Freivalds tolerance is tight enough to matter: a correct c has to pass and the same c with one element
+ * off by 5% has to fail
+ */
+static bool RunCheckInject(Matrix &a, Matrix &b)
+{
+    int m = a.h;
+    int n = b.w;
+    Buffer<float> outputData(static_cast<size_t>(m) * n);
+    Matrix output(outputData.data(), m, n);
+    GeMM::Reference(a, b, output);
+    bool accepted = GeMM::CheckFreivalds(a, b, output);
+    float &fault = output.data[static_cast<size_t>(m / 3) * n + n / 2];
+    fault = fault * 1.05f + (fault == 0.0f ? 1.0f : 0.0f);
+    bool rejected = !GeMM::CheckFreivalds(a, b, output);
+    if (accepted && rejected) {
+        LOGI("Check inject passed! correct c accepted, C[%d][%d] off by 5%% rejected", m / 3, n / 2);
+    } else {
+        LOGE("Check inject failed! correct c %s, corrupted c %s", accepted ? "accepted" : "rejected",
+            rejected ? "rejected" : "accepted");
+    }
+    return accepted && rejected;
+}
+
+/**
+ * tell why IsSupported rejected a kernel, a layout the kernel cannot read is reported apart from isa and alignment
+ */
+static void LogSkipped(const KernelInfo &info, const Matrix &a, const Matrix &b)
+{
+    if (!info.anyOrder && (a.order != MatrixOrder::ROW_MAJOR || b.order != MatrixOrder::ROW_MAJOR)) {
+        LOGW("%s skipped, it only reads row major a and b", info.name.c_str());
+        return;
+    }
+    LOGW("%s skipped, it needs isa %s and sizes aligned to %dx%dx%d", info.name.c_str(),
+        KernelRegistry::IsaToString(info.isa).c_str(), info.alignM, info.alignN, info.alignK);
+}
+
 int main(int argc, char *argv[])
 {
     bool allTests = true;
-    std::vector<std::pair<std::function<void(Matrix &, Matrix &, Matrix &)>, bool>> tests{
-        {GeMM::Optimize1, false},
-        {GeMM::Optimize2, false},
-        {GeMM::Optimize3, false},
-        {GeMM::Optimize4, false},
-        {GeMM::Optimize5, false},
-        {GeMM::Optimize6, false},
-        {GeMM::Optimize7, false},
-        {GeMM::Optimize8, false},
-        {GeMM::Optimize9, false},
-        {GeMM::Optimize10, false},
-        {GeMM::Optimize11, false},
-        {GeMM::Optimize12, false},
-        {GeMM::Optimize13, false},
-        {GeMM::Optimize14, false},
-        {GeMM::Optimize15, false},
-        {GeMM::Optimize16, false},
-    };
+    const std::vector<KernelInfo> &tests = KernelRegistry::GetInstance().GetKernels();
+    std::vector<bool> enabled(tests.size(), false);
     int size = 1024;
     bool check = false;
+    bool checkExact = false;
+    bool tune = false;
+    const char *tuningFile = DEFAULT_TUNING_FILE;
+    const char *inputAFile = nullptr;
+    const char *inputBFile = nullptr;
+    const char *outputFile = nullptr;
+    const char *saveAFile = nullptr;
+    const char *saveBFile = nullptr;
+    int outOfCoreTile = 0;
+    int numaNodeNum = 0;
+    bool strassenReport = false;
+    bool transposeBench = false;
+    bool sparsitySweep = false;
+    bool sparse24Bench = false;
+    bool sddmmBench = false;
+    bool abftInject = false;
+    bool checkInject = false;
+    MatrixOrder orderA = MatrixOrder::ROW_MAJOR;
+    MatrixOrder orderB = MatrixOrder::ROW_MAJOR;
+    StrassenParams strassenParams;
+    const char *corePolicy = nullptr;
 
     for (int i = 1; i < argc; i++) {
         if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0)) {
@@ -59,27 +560,148 @@ int main(int argc, char *argv[])
         } else if (strcmp(argv[i], "--test") == 0) {
             allTests = false;
             if (i + 1 < argc) {
+                // the registry sorts kernels by name, keep test n pointing at Optimize n as it always has
                 int idx = atoi(argv[i + 1]);
-                if (idx > 0 && idx <= tests.size()) {
-                    tests[idx - 1].second = true;
+                std::vector<const KernelInfo *> matched =
+                    KernelRegistry::GetInstance().Match("Optimize" + std::to_string(idx));
+                if (idx > 0 && matched.size() == 1) {
+                    enabled[matched[0] - tests.data()] = true;
                 } else {
                     LOGE("Invalid test index: %d", idx);
                     exit(-1);
                 }
                 i++;
             }
+        } else if (strcmp(argv[i], "--kernel") == 0) {
+            allTests = false;
+            if (i + 1 < argc) {
+                std::vector<const KernelInfo *> matched = KernelRegistry::GetInstance().Match(argv[i + 1]);
+                if (matched.empty()) {
+                    LOGE("No kernel matches: %s", argv[i + 1]);
+                    exit(-1);
+                }
+                for (const KernelInfo *info : matched) {
+                    enabled[info - tests.data()] = true;
+                }
+                i++;
+            }
         } else if (strcmp(argv[i], "--all-tests") == 0) {
             allTests = false;
-            for (auto &test : tests) {
-                test.second = true;
+            enabled.assign(tests.size(), true);
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (size_t idx = 0; idx < tests.size(); idx++) {
+                printf("%zu %s\t%s\t%s\t%s\n", idx + 1, tests[idx].name.c_str(), tests[idx].dtype.c_str(),
+                    KernelRegistry::IsaToString(tests[idx].isa).c_str(), tests[idx].description.c_str());
             }
+            exit(0);
         } else if (strcmp(argv[i], "--size") == 0) {
             if (i + 1 < argc) {
                 size = atoi(argv[i + 1]);
                 i++;
             }
+        } else if (strcmp(argv[i], "--input-a") == 0) {
+            if (i + 1 < argc) {
+                inputAFile = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--input-b") == 0) {
+            if (i + 1 < argc) {
+                inputBFile = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--output") == 0) {
+            if (i + 1 < argc) {
+                outputFile = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--layout-a") == 0 || strcmp(argv[i], "--layout-b") == 0) {
+            if (i + 1 < argc) {
+                if (!ParseOrder(argv[i + 1], argv[i][9] == 'a' ? orderA : orderB)) {
+                    LOGE("Invalid layout: %s", argv[i + 1]);
+                    exit(-1);
+                }
+                i++;
+            }
+        } else if (strcmp(argv[i], "--save-a") == 0) {
+            if (i + 1 < argc) {
+                saveAFile = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--save-b") == 0) {
+            if (i + 1 < argc) {
+                saveBFile = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--out-of-core") == 0) {
+            if (i + 1 < argc) {
+                outOfCoreTile = atoi(argv[i + 1]);
+                i++;
+            }
+        } else if (strcmp(argv[i], "--strassen-depth") == 0) {
+            if (i + 1 < argc) {
+                strassenParams.depth = std::max(atoi(argv[i + 1]), 0);
+                i++;
+            }
+        } else if (strcmp(argv[i], "--strassen-cutoff") == 0) {
+            if (i + 1 < argc) {
+                strassenParams.cutoff = std::max(atoi(argv[i + 1]), 1);
+                i++;
+            }
+        } else if (strcmp(argv[i], "--strassen-report") == 0) {
+            strassenReport = true;
+        } else if (strcmp(argv[i], "--transpose-bench") == 0) {
+            transposeBench = true;
+        } else if (strcmp(argv[i], "--sparsity-sweep") == 0) {
+            sparsitySweep = true;
+        } else if (strcmp(argv[i], "--sparse24-bench") == 0) {
+            sparse24Bench = true;
+        } else if (strcmp(argv[i], "--sddmm-bench") == 0) {
+            sddmmBench = true;
+        } else if (strcmp(argv[i], "--abft-inject") == 0) {
+            abftInject = true;
+        } else if (strcmp(argv[i], "--check-inject") == 0) {
+            checkInject = true;
         } else if (strcmp(argv[i], "--check") == 0) {
             check = true;
+        } else if (strcmp(argv[i], "--check-exact") == 0) {
+            checkExact = true;
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            tune = true;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            if (i + 1 < argc) {
+                HugePageMode mode;
+                if (!ParseHugePageMode(argv[i + 1], mode)) {
+                    LOGE("Invalid huge page mode: %s", argv[i + 1]);
+                    exit(-1);
+                }
+                SetHugePageMode(mode);
+                i++;
+            }
+        } else if (strcmp(argv[i], "--prefetch") == 0) {
+            if (i + 1 < argc) {
+                Autotuner::GetInstance().SetPrefetchDistance(atoi(argv[i + 1]));
+                i++;
+            }
+        } else if (strcmp(argv[i], "--cores") == 0) {
+            if (i + 1 < argc) {
+                corePolicy = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            if (i + 1 < argc) {
+                numaNodeNum = atoi(argv[i + 1]);
+                i++;
+            }
+        } else if (strcmp(argv[i], "--tuning-file") == 0) {
+            if (i + 1 < argc) {
+                tuningFile = argv[i + 1];
+                i++;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                ThreadPool::GetInstance().SetThreadNum(atoi(argv[i + 1]));
+                i++;
+            }
         } else {
             LOGE("Invalid option: %s", argv[i]);
             LOGI("%s", helpStr);
@@ -87,52 +709,165 @@ int main(int argc, char *argv[])
         }
     }
     if (allTests) {
-        for (auto &test : tests) {
-            test.second = true;
-        }
+        enabled.assign(tests.size(), true);
     }
-
-    std::vector<float> input1Data(size * size);
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            input1Data[i * size + j] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    SetStrassenParams(strassenParams);
+    if (corePolicy) {
+        std::vector<int> cores;
+        if (!ParseCorePolicy(corePolicy, cores)) {
+            LOGE("Invalid core policy: %s", corePolicy);
+            exit(-1);
         }
+        std::string coreList;
+        for (int cpu : cores) {
+            coreList += (coreList.empty() ? "" : ",") + std::to_string(cpu) + ":" + std::to_string(GetCpuCapacity(cpu));
+        }
+        LOGI("Threads bound to cpu:capacity %s", coreList.c_str());
+        ThreadPool::GetInstance().SetCores(cores);
+    }
+    if (numaNodeNum > 0) {
+        ThreadPool::GetInstance().SetNumaNodeNum(numaNodeNum);
+        LOGI("%d threads bound to %d NUMA nodes", ThreadPool::GetInstance().GetThreadNum(),
+            ThreadPool::GetInstance().GetNumaNodeNum());
     }
-    Matrix input1{input1Data, size, size};
-    std::vector<float> input2Data(size * size);
-    for (int i = 0; i < size; i++) {
-        for (int j = 0; j < size; j++) {
-            input2Data[i * size + j] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    if (outOfCoreTile > 0) {
+        const char *pathA = inputAFile ? inputAFile : saveAFile;
+        const char *pathB = inputBFile ? inputBFile : saveBFile;
+        if (!pathA || !pathB || !outputFile) {
+            LOGE("--out-of-core needs a and b files (--input-a/--save-a, --input-b/--save-b) and --output");
+            exit(-1);
         }
+        // input files are never loaded, they may not fit in memory. random inputs go through memory once to be saved
+        Buffer<float> randomData;
+        if ((!inputAFile && !WriteMatrixFile(saveAFile, RandomMatrix(randomData, size, size))) ||
+            (!inputBFile && !WriteMatrixFile(saveBFile, RandomMatrix(randomData, size, size)))) {
+            exit(-1);
+        }
+        Autotuner::GetInstance().Load(tuningFile);
+        if (tune) {
+            // the kernel only ever sees tile x tile blocks
+            Autotuner::GetInstance().Tune(outOfCoreTile, outOfCoreTile, outOfCoreTile);
+            Autotuner::GetInstance().Save(tuningFile);
+        }
+        return RunOutOfCore(pathA, pathB, outputFile, outOfCoreTile, check, checkExact) ? 0 : -1;
+    }
+    MappedMatrix input1File;
+    MappedMatrix input2File;
+    Buffer<float> input1Data;
+    Buffer<float> input2Data;
+    Matrix input1 = inputAFile ? LoadMatrix(input1File, inputAFile) : RandomMatrix(input1Data, size, size);
+    Matrix input2 = inputBFile ? LoadMatrix(input2File, inputBFile) : RandomMatrix(input2Data, size, size);
+    if (input1.w != input2.h) {
+        LOGE("Matrix A's width(%d) is not equal to Matrix B's height(%d)", input1.w, input2.h);
+        exit(-1);
+    }
+    if ((saveAFile && !WriteMatrixFile(saveAFile, input1)) || (saveBFile && !WriteMatrixFile(saveBFile, input2))) {
+        exit(-1);
     }
-    Matrix input2{input2Data, size, size};
+    int m = input1.h;
+    int n = input2.w;
+    int k = input1.w;
+    // the kernels get a and b in the requested order, the checks keep the row major originals
+    Buffer<float> kernelAData;
+    Buffer<float> kernelBData;
+    Matrix kernelA = orderA == MatrixOrder::ROW_MAJOR ? input1 : ConvertOrder(input1, kernelAData, orderA);
+    Matrix kernelB = orderB == MatrixOrder::ROW_MAJOR ? input2 : ConvertOrder(input2, kernelBData, orderB);
 
-    if (check) {
-        for (int i = 0; i < tests.size(); i++) {
-            if (!tests[i].second) {
+    Autotuner::GetInstance().Load(tuningFile);
+    if (tune) {
+        Autotuner::GetInstance().Tune(m, n, k);
+        Autotuner::GetInstance().Save(tuningFile);
+    }
+
+    if (transposeBench) {
+        RunTransposeBench(input1);
+        return 0;
+    }
+    if (sparsitySweep) {
+        RunSparsitySweep(input1, input2);
+        return 0;
+    }
+    if (sparse24Bench) {
+        RunSparse24Bench(input1, input2);
+        return 0;
+    }
+    if (sddmmBench) {
+        RunSddmmBench(input1, input2);
+        return 0;
+    }
+    if (abftInject) {
+        return RunAbftInject(input1, input2) ? 0 : -1;
+    }
+    if (checkInject) {
+        return RunCheckInject(input1, input2) ? 0 : -1;
+    }
+    if (strassenReport) {
+        RunStrassenReport(input1, input2);
+        return 0;
+    }
+    MappedMatrix outputFileData;
+    Buffer<float> outputData;
+    if (outputFile) {
+        if (!outputFileData.Create(outputFile, m, n)) {
+            exit(-1);
+        }
+    } else {
+        outputData = Buffer<float>(static_cast<size_t>(m) * n, AllocInit::UNTOUCHED);
+        ParallelFirstTouch(outputData.data(), m, n);
+    }
+    Matrix output = outputFile ? outputFileData.GetMatrix() : Matrix(outputData.data(), m, n);
+    size_t outputBytes = static_cast<size_t>(m) * n * sizeof(float);
+    if (check || checkExact) {
+        Buffer<float> referenceData;
+        if (checkExact) {
+            referenceData = Buffer<float>(static_cast<size_t>(m) * n);
+            Matrix reference{referenceData.data(), m, n};
+            GeMM::Reference(input1, input2, reference);
+        }
+        for (size_t i = 0; i < tests.size(); i++) {
+            if (!enabled[i]) {
+                continue;
+            }
+            if (!KernelRegistry::IsSupported(tests[i], kernelA, kernelB, output)) {
+                LogSkipped(tests[i], kernelA, kernelB);
                 continue;
             }
-            std::vector<float> output1Data(size * size);
-            Matrix output1{output1Data, size, size};
-            std::vector<float> output2Data(size * size);
-            Matrix output2{output2Data, size, size};
-            GeMM::Origin(input1, input2, output1);
-            tests[i].first(input1, input2, output2);
-            if (GeMM::CheckResult(output1, output2)) {
-                LOGI("Optimize%d passed!", i + 1);
+            memset(output.data, 0, outputBytes);
+            tests[i].func(kernelA, kernelB, output);
+            bool passed = true;
+            if (check) {
+                passed = GeMM::CheckFreivalds(input1, input2, output);
+            }
+            if (passed && checkExact) {
+                Matrix reference{referenceData.data(), m, n};
+                CheckSummary summary = GeMM::CheckResult(reference, output, k);
+                LOGI("%s max abs error %e, max rel error %e, max ulp %u, rms error %e", tests[i].name.c_str(),
+                    summary.maxAbsError, summary.maxRelError, summary.maxUlp, summary.rmsError);
+                passed = summary.passed;
+            }
+            if (passed) {
+                LOGI("%s passed!", tests[i].name.c_str());
             } else {
-                LOGE("Optimize%d failed!", i + 1);
+                LOGE("%s failed!", tests[i].name.c_str());
             }
         }
     } else {
-        for (int i = 0; i < tests.size(); i++) {
-            if (!tests[i].second) {
+        for (size_t i = 0; i < tests.size(); i++) {
+            if (!enabled[i]) {
                 continue;
             }
-            std::vector<float> outputData(size * size);
-            Matrix output{outputData, size, size};
-            tests[i].first(input1, input2, output);
+            if (!KernelRegistry::IsSupported(tests[i], kernelA, kernelB, output)) {
+                LogSkipped(tests[i], kernelA, kernelB);
+                continue;
+            }
+            memset(output.data, 0, outputBytes);
+            tests[i].func(kernelA, kernelB, output);
         }
     }
+    if (outputFile && !outputFileData.Sync()) {
+        LOGE("Failed to write %s", outputFile);
+    }
+    LOGD("Workspace high-water mark %zu KiB per thread, %ld heap allocations", Workspace::GetPeakHighWater() / 1024,
+        Workspace::GetHeapAllocNum());
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#include "log.h"
+#include "matrix_file.h"
+
+static bool IsPowerOfTwo(uint64_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+/**
+ * whether the payload ((rows - 1) * stride + cols) floats at dataOffset lies inside the file, every step is
+ * checked before it is taken so an untrusted header cannot wrap the arithmetic around. cols <= INT_MAX
+ */
+static bool FitsFile(const MatrixFileHeader &header, uint64_t fileLength)
+{
+    if (header.dataOffset > fileLength) {
+        return false;
+    }
+    if (header.rows == 0) {
+        return true;
+    }
+    constexpr uint64_t MAX_ELEMENTS = UINT64_MAX / sizeof(float);
+    if (header.rows > 1 && header.stride > (MAX_ELEMENTS - header.cols) / (header.rows - 1)) {
+        return false;
+    }
+    uint64_t payload = ((header.rows - 1) * header.stride + header.cols) * sizeof(float);
+    return payload <= fileLength - header.dataOffset;
+}
+
+MatrixFileHeader MakeMatrixHeader(int h, int w, size_t alignment)
+{
+    MatrixFileHeader header{};
+    memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.version = MATRIX_FILE_VERSION;
+    header.dtype = MATRIX_DTYPE_F32;
+    header.rows = h;
+    header.cols = w;
+    header.stride = w;
+    header.alignment = alignment;
+    header.dataOffset = (sizeof(header) + alignment - 1) / alignment * alignment;
+    return header;
+}
+
+bool ValidateMatrixHeader(const MatrixFileHeader &header, size_t fileLength, const std::string &path)
+{
+    if (memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MATRIX_FILE_VERSION) {
+        LOGE("%s is not a version %u matrix file", path.c_str(), MATRIX_FILE_VERSION);
+        return false;
+    }
+    if (header.dtype != MATRIX_DTYPE_F32) {
+        LOGE("%s has dtype %u, only f32 is supported", path.c_str(), header.dtype);
+        return false;
+    }
+    if (header.rows > INT_MAX || header.cols > INT_MAX || header.stride < header.cols ||
+        !IsPowerOfTwo(header.alignment) || header.dataOffset % header.alignment != 0 ||
+        header.dataOffset % sizeof(float) != 0 || header.dataOffset < sizeof(header) ||
+        !FitsFile(header, fileLength)) {
+        LOGE("%s has an invalid %llux%llu layout, stride %llu, offset %llu", path.c_str(),
+            static_cast<unsigned long long>(header.rows), static_cast<unsigned long long>(header.cols),
+            static_cast<unsigned long long>(header.stride), static_cast<unsigned long long>(header.dataOffset));
+        return false;
+    }
+    return true;
+}
+
+MappedMatrix::~MappedMatrix()
+{
+    Close();
+}
+
+void MappedMatrix::Close()
+{
+    if (m_map) {
+        munmap(m_map, m_length);
+    }
+    m_map = nullptr;
+    m_length = 0;
+    m_copy = Buffer<float>();
+    m_data = nullptr;
+    m_h = 0;
+    m_w = 0;
+}
+
+bool MappedMatrix::Open(const std::string &path)
+{
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE("Failed to open matrix file %s", path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(MatrixFileHeader)) {
+        LOGE("%s is too small for a matrix file", path.c_str());
+        close(fd);
+        return false;
+    }
+    // read only and without read ahead, so a file larger than memory maps and only the pages touched are read
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOGE("Failed to map matrix file %s", path.c_str());
+        return false;
+    }
+    m_map = map;
+    m_length = st.st_size;
+
+    MatrixFileHeader header;
+    memcpy(&header, m_map, sizeof(header));
+    if (!ValidateMatrixHeader(header, m_length, path)) {
+        Close();
+        return false;
+    }
+    m_h = static_cast<int>(header.rows);
+    m_w = static_cast<int>(header.cols);
+    float *payloadData = reinterpret_cast<float *>(static_cast<char *>(m_map) + header.dataOffset);
+    if (header.stride == header.cols) {
+        m_data = payloadData;
+        return true;
+    }
+    LOGW("%s has stride %llu for width %d, copying it into a dense matrix", path.c_str(),
+        static_cast<unsigned long long>(header.stride), m_w);
+    m_copy = Buffer<float>(static_cast<size_t>(m_h) * m_w);
+    for (int i = 0; i < m_h; i++) {
+        memcpy(m_copy.data() + static_cast<size_t>(i) * m_w, payloadData + i * header.stride, m_w * sizeof(float));
+    }
+    munmap(m_map, m_length);
+    m_map = nullptr;
+    m_length = 0;
+    m_data = m_copy.data();
+    return true;
+}
+
+bool MappedMatrix::Create(const std::string &path, int h, int w, size_t alignment)
+{
+    Close();
+    if (h < 0 || w < 0 || !IsPowerOfTwo(alignment)) {
+        LOGE("Invalid matrix file layout %dx%d, alignment %zu", h, w, alignment);
+        return false;
+    }
+    MatrixFileHeader header = MakeMatrixHeader(h, w, alignment);
+    size_t length = header.dataOffset + static_cast<size_t>(h) * w * sizeof(float);
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOGE("Failed to create matrix file %s", path.c_str());
+        return false;
+    }
+    if (ftruncate(fd, length) != 0) {
+        LOGE("Failed to resize matrix file %s to %zu bytes", path.c_str(), length);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOGE("Failed to map matrix file %s", path.c_str());
+        return false;
+    }
+    memcpy(map, &header, sizeof(header));
+    m_map = map;
+    m_length = length;
+    m_data = reinterpret_cast<float *>(static_cast<char *>(map) + header.dataOffset);
+    m_h = h;
+    m_w = w;
+    return true;
+}
+
+bool MappedMatrix::Sync()
+{
+    return !m_map || msync(m_map, m_length, MS_SYNC) == 0;
+}
+
+bool WriteMatrixFile(const std::string &path, const Matrix &matrix, size_t alignment)
+{
+    if (matrix.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("Matrix files store row major matrices, cannot write %s", path.c_str());
+        return false;
+    }
+    MappedMatrix file;
+    if (!file.Create(path, matrix.h, matrix.w, alignment)) {
+        return false;
+    }
+    memcpy(file.GetMatrix().data, matrix.data, static_cast<size_t>(matrix.h) * matrix.w * sizeof(float));
+    return file.Sync();
+}
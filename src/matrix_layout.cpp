@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include "ThreadPool.h"
+#include "TimePerf.h"
+#include "kernel_registry.h"
+#include "log.h"
+#include "micro_kernel.h"
+#include "matrix_layout.h"
+
+constexpr int LAYOUT_MR = 4;
+constexpr int LAYOUT_NR = 8;
+
+/**
+ * interleave the bits of row and col, row bits in the odd positions
+ */
+static uint64_t MortonCode(uint32_t row, uint32_t col)
+{
+    uint64_t code = 0;
+    for (int bit = 0; bit < 32; bit++) {
+        code |= static_cast<uint64_t>((col >> bit) & 1) << (2 * bit);
+        code |= static_cast<uint64_t>((row >> bit) & 1) << (2 * bit + 1);
+    }
+    return code;
+}
+
+BlockedMatrix::BlockedMatrix(int h, int w, BlockLayout layout)
+    : m_h(h), m_w(w), m_tileRows((h + LAYOUT_TILE - 1) / LAYOUT_TILE), m_tileCols((w + LAYOUT_TILE - 1) / LAYOUT_TILE),
+      m_layout(layout)
+{
+    size_t tileNum = static_cast<size_t>(m_tileRows) * m_tileCols;
+    m_data = Buffer<float>(tileNum * LAYOUT_TILE_SIZE);
+    m_slots.resize(tileNum);
+    std::iota(m_slots.begin(), m_slots.end(), 0);
+    if (layout == BlockLayout::MORTON) {
+        // the grid need not be a square power of two, so the slots are the ranks of the tiles in Z order
+        std::vector<uint32_t> order(tileNum);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](uint32_t x, uint32_t y) {
+            return MortonCode(x / m_tileCols, x % m_tileCols) < MortonCode(y / m_tileCols, y % m_tileCols);
+        });
+        for (size_t slot = 0; slot < tileNum; slot++) {
+            m_slots[order[slot]] = static_cast<uint32_t>(slot);
+        }
+    }
+}
+
+void ToBlocked(const Matrix &src, BlockedMatrix &dst)
+{
+    if (src.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("ToBlocked needs a row major matrix");
+        return;
+    }
+    ThreadPool::GetInstance().ParallelFor(0, dst.GetTileRows(), [&](int begin, int end) {
+        for (int ti = begin; ti < end; ti++) {
+            int rows = std::min(LAYOUT_TILE, src.h - ti * LAYOUT_TILE);
+            for (int tj = 0; tj < dst.GetTileCols(); tj++) {
+                int cols = std::min(LAYOUT_TILE, src.w - tj * LAYOUT_TILE);
+                float *tile = dst.Tile(ti, tj);
+                for (int i = 0; i < rows; i++) {
+                    memcpy(tile + i * LAYOUT_TILE,
+                        src.data + static_cast<size_t>(ti * LAYOUT_TILE + i) * src.w + tj * LAYOUT_TILE,
+                        cols * sizeof(float));
+                }
+            }
+        }
+    });
+}
+
+void FromBlocked(const BlockedMatrix &src, Matrix &dst)
+{
+    if (dst.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("FromBlocked needs a row major matrix");
+        return;
+    }
+    ThreadPool::GetInstance().ParallelFor(0, src.GetTileRows(), [&](int begin, int end) {
+        for (int ti = begin; ti < end; ti++) {
+            int rows = std::min(LAYOUT_TILE, dst.h - ti * LAYOUT_TILE);
+            for (int tj = 0; tj < src.GetTileCols(); tj++) {
+                int cols = std::min(LAYOUT_TILE, dst.w - tj * LAYOUT_TILE);
+                const float *tile = src.Tile(ti, tj);
+                for (int i = 0; i < rows; i++) {
+                    memcpy(dst.data + static_cast<size_t>(ti * LAYOUT_TILE + i) * dst.w + tj * LAYOUT_TILE,
+                        tile + i * LAYOUT_TILE, cols * sizeof(float));
+                }
+            }
+        }
+    });
+}
+
+/**
+ * c tile += a tile * b tile, all LAYOUT_TILE x LAYOUT_TILE row major, in 4x8 register tiles
+ */
+static void TileKernel(const float *pA, const float *pB, float *pC)
+{
+    for (int i = 0; i < LAYOUT_TILE; i += LAYOUT_MR) {
+        for (int j = 0; j < LAYOUT_TILE; j += LAYOUT_NR) {
+            MicroKernelRowMajor<float, LAYOUT_MR, LAYOUT_NR>(LAYOUT_TILE, pA + i * LAYOUT_TILE, LAYOUT_TILE, pB + j,
+                LAYOUT_TILE, pC + i * LAYOUT_TILE + j, LAYOUT_TILE, 0);
+        }
+    }
+}
+
+bool BlockedGemm(const BlockedMatrix &a, const BlockedMatrix &b, BlockedMatrix &c)
+{
+    if (a.GetWidth() != b.GetHeight() || a.GetHeight() != c.GetHeight() || b.GetWidth() != c.GetWidth()) {
+        LOGE("Cannot multiply blocked %dx%d by %dx%d into %dx%d", a.GetHeight(), a.GetWidth(), b.GetHeight(),
+            b.GetWidth(), c.GetHeight(), c.GetWidth());
+        return false;
+    }
+    int tileDepth = a.GetTileCols();
+    ThreadPool::GetInstance().ParallelFor(0, c.GetTileRows(), [&](int begin, int end) {
+        for (int ti = begin; ti < end; ti++) {
+            for (int tk = 0; tk < tileDepth; tk++) {
+                const float *tileA = a.Tile(ti, tk);
+                for (int tj = 0; tj < c.GetTileCols(); tj++) {
+                    TileKernel(tileA, b.Tile(tk, tj), c.Tile(ti, tj));
+                }
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * convert a, b and c to the layout, multiply on the tiles and convert c back. the conversions are timed apart
+ * from the product, which is what a chain of products that stays in the layout pays
+ */
+static void LayoutGemm(Matrix &a, Matrix &b, Matrix &c, BlockLayout layout)
+{
+    BlockedMatrix blockedA(a.h, a.w, layout);
+    BlockedMatrix blockedB(b.h, b.w, layout);
+    BlockedMatrix blockedC(c.h, c.w, layout);
+    {
+        TIMEPERF(ToBlocked);
+        ToBlocked(a, blockedA);
+        ToBlocked(b, blockedB);
+        ToBlocked(c, blockedC);
+    }
+    {
+        TIMEPERF(BlockedGemm);
+        BlockedGemm(blockedA, blockedB, blockedC);
+    }
+    TIMEPERF(FromBlocked);
+    FromBlocked(blockedC, c);
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * tile major layout: a, b and c as 64x64 row major tiles stored in row major tile order,
+ * every tile product runs on contiguous memory with 4x8 register tiles, rows of tiles split across the thread pool
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Tiled(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    TIMEPERF(Tiled);
+    LayoutGemm(a, b, c, BlockLayout::TILED);
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * Morton layout: a, b and c as 64x64 row major tiles stored in Z order of the tile coordinates,
+ * every tile product runs on contiguous memory with 4x8 register tiles, rows of tiles split across the thread pool
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Morton(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    TIMEPERF(Morton);
+    LayoutGemm(a, b, c, BlockLayout::MORTON);
+}
+
+REGISTER_KERNEL(Tiled, KernelInfo("Tiled", "64x64 tile major layout, 4x8 register tile, multi-thread", GeMM::Tiled)
+                           .Vector(SIMD_WIDTH)
+                           .Cost(0.7f, 32.0f)
+                           .Parallel()
+                           .Manual());
+REGISTER_KERNEL(Morton, KernelInfo("Morton", "64x64 tiles in Z order, 4x8 register tile, multi-thread", GeMM::Morton)
+                            .Vector(SIMD_WIDTH)
+                            .Cost(0.7f, 32.0f)
+                            .Parallel()
+                            .Manual());
@@ -0,0 +1,66 @@
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include "ThreadPool.h"
+#include "cpu_info.h"
+#include "log.h"
+#include "numa.h"
+
+/* from linux/mempolicy.h, spelled out so that no libnuma headers are needed */
+constexpr int MPOL_BIND_MODE = 2;
+constexpr unsigned MPOL_MF_MOVE_FLAG = 1 << 1;
+constexpr int NODE_MASK_BITS = 1024;
+
+bool BindThreadToCpus(const std::vector<int> &cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0 || syscall(SYS_sched_setaffinity, 0, sizeof(set), &set) != 0) {
+        LOGW("Failed to bind thread to %zu cpus: %s", cpus.size(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool BindThreadToNode(int index)
+{
+    const std::vector<NumaNode> &nodes = GetNumaNodes();
+    if (index < 0 || index >= static_cast<int>(nodes.size())) {
+        return false;
+    }
+    return BindThreadToCpus(nodes[index].cpus);
+}
+
+bool BindMemoryToNode(void *addr, size_t bytes, int index)
+{
+    const std::vector<NumaNode> &nodes = GetNumaNodes();
+    if (index < 0 || index >= static_cast<int>(nodes.size()) || nodes[index].id >= NODE_MASK_BITS || bytes == 0) {
+        return false;
+    }
+    uintptr_t pageBytes = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(addr) / pageBytes * pageBytes;
+    uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + bytes + pageBytes - 1) / pageBytes * pageBytes;
+    unsigned long mask[NODE_MASK_BITS / (8 * sizeof(unsigned long))] = {};
+    int id = nodes[index].id;
+    mask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, begin, end - begin, MPOL_BIND_MODE, mask, NODE_MASK_BITS, MPOL_MF_MOVE_FLAG) != 0) {
+        LOGW("Failed to bind %zu bytes to node %d: %s", bytes, id, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void ParallelFirstTouch(float *data, size_t rows, size_t rowLen)
+{
+    ThreadPool::GetInstance().ParallelFor(0, static_cast<int>(rows), [&](int begin, int end) {
+        memset(data + begin * rowLen, 0, (end - begin) * rowLen * sizeof(float));
+    });
+}
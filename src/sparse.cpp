@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <cmath>
+#include "ThreadPool.h"
+#include "TimePerf.h"
+#include "kernel_registry.h"
+#include "log.h"
+#include "micro_kernel.h"
+#include "sparse.h"
+#include "transpose.h"
+#include "workspace.h"
+
+constexpr int CSR_NV = 8;           /**< Vectors of c per row tile of the CSR kernel */
+constexpr int BSR_NV = 2;           /**< Vectors of c per row of a block row tile of the BSR kernel */
+constexpr int SPMM_PREFETCH = 4;    /**< Nonzeros ahead whose b rows are prefetched */
+constexpr int SPARSE24_MR = 3;      /**< Rows of c per register tile of the 2:4 kernel */
+constexpr int SPARSE24_NV = 4;      /**< Vectors of c per row of a register tile of the 2:4 kernel */
+constexpr int SPARSE24_STRIP = SPARSE24_NV * VectorTraits<float>::WIDTH;
+constexpr int SPARSE24_KC = 256;    /**< Rows of a packed b strip, a multiple of 8 so blocks start on index bytes */
+constexpr int SDDMM_NR = 4;         /**< Nonzeros of a mask row whose dot products share the loads of a */
+
+CsrMatrix::CsrMatrix(const Matrix &dense) : m_rowPtr(dense.h + 1, 0), m_h(dense.h), m_w(dense.w)
+{
+    if (dense.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("CSR compression needs a row major matrix");
+        *this = CsrMatrix();
+        return;
+    }
+    for (int i = 0; i < m_h; i++) {
+        const float *row = dense.data + static_cast<size_t>(i) * m_w;
+        for (int j = 0; j < m_w; j++) {
+            if (row[j] != 0.0f) {
+                m_colIdx.push_back(j);
+                m_values.push_back(row[j]);
+            }
+        }
+        m_rowPtr[i + 1] = static_cast<int>(m_values.size());
+    }
+}
+
+BsrMatrix::BsrMatrix(const Matrix &dense)
+    : m_rowPtr((dense.h + BSR_BLOCK - 1) / BSR_BLOCK + 1, 0), m_h(dense.h), m_w(dense.w)
+{
+    if (dense.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("BSR compression needs a row major matrix");
+        *this = BsrMatrix();
+        return;
+    }
+    int blockCols = (m_w + BSR_BLOCK - 1) / BSR_BLOCK;
+    for (int bi = 0; bi < GetBlockRows(); bi++) {
+        int rows = std::min(BSR_BLOCK, m_h - bi * BSR_BLOCK);
+        for (int bj = 0; bj < blockCols; bj++) {
+            int cols = std::min(BSR_BLOCK, m_w - bj * BSR_BLOCK);
+            float block[BSR_BLOCK_SIZE] = {};
+            bool nonZero = false;
+            for (int i = 0; i < rows; i++) {
+                const float *row = dense.data + static_cast<size_t>(bi * BSR_BLOCK + i) * m_w + bj * BSR_BLOCK;
+                for (int j = 0; j < cols; j++) {
+                    block[i * BSR_BLOCK + j] = row[j];
+                    nonZero |= row[j] != 0.0f;
+                }
+            }
+            if (nonZero) {
+                m_colIdx.push_back(bj);
+                m_values.insert(m_values.end(), block, block + BSR_BLOCK_SIZE);
+            }
+        }
+        m_rowPtr[bi + 1] = static_cast<int>(m_colIdx.size());
+    }
+}
+
+Sparse24Matrix::Sparse24Matrix(const Matrix &dense) : m_h(dense.h), m_w(dense.w), m_groupNum((dense.w + 3) / 4)
+{
+    if (dense.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("2:4 compression needs a row major matrix");
+        *this = Sparse24Matrix();
+        return;
+    }
+    m_values.assign(static_cast<size_t>(m_h) * m_groupNum * 2, 0.0f);
+    m_indices.assign(static_cast<size_t>(m_h) * GetIndexStride(), 0);
+    for (int i = 0; i < m_h; i++) {
+        const float *row = dense.data + static_cast<size_t>(i) * m_w;
+        float *values = m_values.data() + static_cast<size_t>(i) * m_groupNum * 2;
+        uint8_t *indices = m_indices.data() + static_cast<size_t>(i) * GetIndexStride();
+        for (int g = 0; g < m_groupNum; g++) {
+            int cols = std::min(4, m_w - g * 4);
+            int order[4] = {0, 1, 2, 3};
+            std::stable_sort(order, order + cols, [&](int x, int y) {
+                return std::abs(row[g * 4 + x]) > std::abs(row[g * 4 + y]);
+            });
+            // a single column group repeats its only index with a zero value
+            int first = std::min(order[0], cols > 1 ? order[1] : order[0]);
+            int second = cols > 1 ? std::max(order[0], order[1]) : first;
+            values[g * 2] = row[g * 4 + first];
+            values[g * 2 + 1] = second != first ? row[g * 4 + second] : 0.0f;
+            indices[g / 2] |= static_cast<uint8_t>((first | (second << 2)) << ((g % 2) * 4));
+        }
+    }
+}
+
+void Sparse24Matrix::ToDense(Matrix &dense) const
+{
+    if (dense.order != MatrixOrder::ROW_MAJOR || dense.h != m_h || dense.w != m_w) {
+        LOGE("Cannot expand 2:4 sparse %dx%d into a %dx%d %s major matrix", m_h, m_w, dense.h, dense.w,
+            dense.order == MatrixOrder::ROW_MAJOR ? "row" : "column");
+        return;
+    }
+    for (int i = 0; i < m_h; i++) {
+        float *row = dense.data + static_cast<size_t>(i) * m_w;
+        const float *values = m_values.data() + static_cast<size_t>(i) * m_groupNum * 2;
+        const uint8_t *indices = m_indices.data() + static_cast<size_t>(i) * GetIndexStride();
+        std::fill(row, row + m_w, 0.0f);
+        for (int g = 0; g < m_groupNum; g++) {
+            int index = indices[g / 2] >> ((g % 2) * 4);
+            row[g * 4 + (index & 3)] += values[g * 2];
+            row[g * 4 + ((index >> 2) & 3)] += values[g * 2 + 1];
+        }
+    }
+}
+
+/**
+ * c[0:NV * WIDTH] += sum of values[p] * b row colIdx[p] over the nnz nonzeros of a row, the c vectors stay in
+ * registers across the nonzeros
+ */
+template <int NV>
+static inline void CsrRowTile(const float *values, const int *colIdx, int nnz, const float *b, size_t ldb, float *c)
+{
+    using V = VectorTraits<float>;
+    typename V::Type acc[NV];
+    StaticFor<NV>([&](auto v) { acc[v] = V::Zero(); });
+    for (int p = 0; p < nnz; p++) {
+        if (p + SPMM_PREFETCH < nnz) {
+            PREFETCH_READ(b + colIdx[p + SPMM_PREFETCH] * ldb);
+        }
+        const float *row = b + colIdx[p] * ldb;
+        float value = values[p];
+        StaticFor<NV>([&](auto v) { acc[v] = V::Fma(acc[v], V::Load(row + v * V::WIDTH), value); });
+    }
+    StaticFor<NV>([&](auto v) { V::Store(c + v * V::WIDTH, V::Add(V::Load(c + v * V::WIDTH), acc[v])); });
+}
+
+bool SpMM(const CsrMatrix &a, const Matrix &b, Matrix &c)
+{
+    if (a.GetWidth() != b.h || a.GetHeight() != c.h || b.w != c.w) {
+        LOGE("Cannot multiply sparse %dx%d by %dx%d into %dx%d", a.GetHeight(), a.GetWidth(), b.h, b.w, c.h, c.w);
+        return false;
+    }
+    if (b.order != MatrixOrder::ROW_MAJOR || c.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("SpMM needs row major b and c");
+        return false;
+    }
+    constexpr int WIDTH = VectorTraits<float>::WIDTH;
+    int n = b.w;
+    ThreadPool::GetInstance().ParallelFor(0, a.GetHeight(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int first = a.GetRowPtr()[i];
+            int nnz = a.GetRowPtr()[i + 1] - first;
+            const float *values = a.GetValues() + first;
+            const int *colIdx = a.GetColIdx() + first;
+            float *rowC = c.data + static_cast<size_t>(i) * n;
+            int j = 0;
+            for (; j + CSR_NV * WIDTH <= n; j += CSR_NV * WIDTH) {
+                CsrRowTile<CSR_NV>(values, colIdx, nnz, b.data + j, n, rowC + j);
+            }
+            for (; j + WIDTH <= n; j += WIDTH) {
+                CsrRowTile<1>(values, colIdx, nnz, b.data + j, n, rowC + j);
+            }
+            for (; j < n; j++) {
+                float sum = 0.0f;
+                for (int p = 0; p < nnz; p++) {
+                    sum += values[p] * b.data[static_cast<size_t>(colIdx[p]) * n + j];
+                }
+                rowC[j] += sum;
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * c[0:rows][0:NV * WIDTH] += the blocks of a block row times the matching b rows, k limits the b rows read by
+ * the padded blocks of the last block column
+ */
+template <int NV>
+static inline void BsrRowTile(const float *blocks, const int *colIdx, int blockNum, const float *b, size_t ldb, int k,
+    float *c, size_t ldc, int rows)
+{
+    using V = VectorTraits<float>;
+    typename V::Type acc[BSR_BLOCK][NV];
+    StaticFor<BSR_BLOCK>([&](auto r) { StaticFor<NV>([&](auto v) { acc[r][v] = V::Zero(); }); });
+    for (int q = 0; q < blockNum; q++) {
+        int col = colIdx[q] * BSR_BLOCK;
+        const float *block = blocks + q * BSR_BLOCK_SIZE;
+        const float *rowB = b + col * ldb;
+        auto step = [&](int p) {
+            typename V::Type vB[NV];
+            StaticFor<NV>([&](auto v) { vB[v] = V::Load(rowB + p * ldb + v * V::WIDTH); });
+            StaticFor<BSR_BLOCK>([&](auto r) {
+                float value = block[r * BSR_BLOCK + p];
+                StaticFor<NV>([&](auto v) { acc[r][v] = V::Fma(acc[r][v], vB[v], value); });
+            });
+        };
+        if (col + BSR_BLOCK <= k) {
+            StaticFor<BSR_BLOCK>(step);
+        } else {
+            for (int p = 0; p < k - col; p++) {
+                step(p);
+            }
+        }
+    }
+    StaticFor<BSR_BLOCK>([&](auto r) {
+        if (r < rows) {
+            StaticFor<NV>([&](auto v) {
+                float *pC = c + r * ldc + v * V::WIDTH;
+                V::Store(pC, V::Add(V::Load(pC), acc[r][v]));
+            });
+        }
+    });
+}
+
+bool SpMM(const BsrMatrix &a, const Matrix &b, Matrix &c)
+{
+    if (a.GetWidth() != b.h || a.GetHeight() != c.h || b.w != c.w) {
+        LOGE("Cannot multiply block sparse %dx%d by %dx%d into %dx%d", a.GetHeight(), a.GetWidth(), b.h, b.w, c.h,
+            c.w);
+        return false;
+    }
+    if (b.order != MatrixOrder::ROW_MAJOR || c.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("SpMM needs row major b and c");
+        return false;
+    }
+    constexpr int WIDTH = VectorTraits<float>::WIDTH;
+    int n = b.w;
+    int k = b.h;
+    ThreadPool::GetInstance().ParallelFor(0, a.GetBlockRows(), [&](int begin, int end) {
+        for (int bi = begin; bi < end; bi++) {
+            int first = a.GetRowPtr()[bi];
+            int blockNum = a.GetRowPtr()[bi + 1] - first;
+            const float *blocks = a.GetValues() + static_cast<size_t>(first) * BSR_BLOCK_SIZE;
+            const int *colIdx = a.GetColIdx() + first;
+            int rows = std::min(BSR_BLOCK, a.GetHeight() - bi * BSR_BLOCK);
+            float *tileC = c.data + static_cast<size_t>(bi) * BSR_BLOCK * n;
+            int j = 0;
+            for (; j + BSR_NV * WIDTH <= n; j += BSR_NV * WIDTH) {
+                BsrRowTile<BSR_NV>(blocks, colIdx, blockNum, b.data + j, n, k, tileC + j, n, rows);
+            }
+            for (; j + WIDTH <= n; j += WIDTH) {
+                BsrRowTile<1>(blocks, colIdx, blockNum, b.data + j, n, k, tileC + j, n, rows);
+            }
+            for (; j < n; j++) {
+                for (int q = 0; q < blockNum; q++) {
+                    int col = colIdx[q] * BSR_BLOCK;
+                    const float *block = blocks + q * BSR_BLOCK_SIZE;
+                    for (int r = 0; r < rows; r++) {
+                        float sum = 0.0f;
+                        for (int p = 0; p < std::min(BSR_BLOCK, k - col); p++) {
+                            sum += block[r * BSR_BLOCK + p] * b.data[static_cast<size_t>(col + p) * n + j];
+                        }
+                        tileC[r * n + j] += sum;
+                    }
+                }
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * c[0:MR][0:SPARSE24_STRIP] += groupNum groups of MR rows of a times the packed strip, group g selecting strip
+ * rows 4 * g + its 2 indices. values and indices point at the first row, group g of the tile is group g0 + g of a
+ */
+template <int MR>
+static inline void Sparse24Tile(const float *values, size_t valueLd, const uint8_t *indices, size_t indexLd, int g0,
+    int groupNum, const float *strip, float *c, size_t ldc)
+{
+    using V = VectorTraits<float>;
+    typename V::Type acc[MR][SPARSE24_NV];
+    StaticFor<MR>([&](auto r) { StaticFor<SPARSE24_NV>([&](auto v) { acc[r][v] = V::Zero(); }); });
+    for (int g = 0; g < groupNum; g++) {
+        int group = g0 + g;
+        const float *rows = strip + g * 4 * SPARSE24_STRIP;
+        StaticFor<MR>([&](auto r) {
+            int index = indices[r * indexLd + group / 2] >> ((group % 2) * 4);
+            const float *row0 = rows + (index & 3) * SPARSE24_STRIP;
+            const float *row1 = rows + ((index >> 2) & 3) * SPARSE24_STRIP;
+            float value0 = values[r * valueLd + g * 2];
+            float value1 = values[r * valueLd + g * 2 + 1];
+            StaticFor<SPARSE24_NV>([&](auto v) {
+                acc[r][v] = V::Fma(acc[r][v], V::Load(row0 + v * V::WIDTH), value0);
+                acc[r][v] = V::Fma(acc[r][v], V::Load(row1 + v * V::WIDTH), value1);
+            });
+        });
+    }
+    StaticFor<MR>([&](auto r) {
+        StaticFor<SPARSE24_NV>([&](auto v) {
+            float *pC = c + r * ldc + v * V::WIDTH;
+            V::Store(pC, V::Add(V::Load(pC), acc[r][v]));
+        });
+    });
+}
+
+bool SpMM(const Sparse24Matrix &a, const Matrix &b, Matrix &c)
+{
+    if (a.GetWidth() != b.h || a.GetHeight() != c.h || b.w != c.w) {
+        LOGE("Cannot multiply 2:4 sparse %dx%d by %dx%d into %dx%d", a.GetHeight(), a.GetWidth(), b.h, b.w, c.h,
+            c.w);
+        return false;
+    }
+    if (b.order != MatrixOrder::ROW_MAJOR || c.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("SpMM needs row major b and c");
+        return false;
+    }
+    int m = c.h;
+    int n = c.w;
+    int k = b.h;
+    size_t valueLd = static_cast<size_t>(a.GetGroupNum()) * 2;
+    size_t indexLd = a.GetIndexStride();
+    int stripNum = (n + SPARSE24_STRIP - 1) / SPARSE24_STRIP;
+    ThreadPool::GetInstance().ParallelFor(0, stripNum, [&](int begin, int end) {
+        Workspace &workspace = Workspace::GetThreadLocal();
+        Workspace::Scope scope(workspace);
+        float *strip = workspace.Alloc<float>(static_cast<size_t>(SPARSE24_KC) * SPARSE24_STRIP);
+        // the last strip is computed into an edge tile and only its valid columns are added to c
+        alignas(CACHE_LINE_BYTES) float edge[SPARSE24_MR * SPARSE24_STRIP];
+        for (int s = begin; s < end; s++) {
+            int j = s * SPARSE24_STRIP;
+            int cols = std::min(SPARSE24_STRIP, n - j);
+            for (int pc = 0; pc < k; pc += SPARSE24_KC) {
+                int kc = std::min(SPARSE24_KC, k - pc);
+                for (int p = 0; p < kc; p++) {
+                    const float *rowB = b.data + static_cast<size_t>(pc + p) * n + j;
+                    std::copy(rowB, rowB + cols, strip + p * SPARSE24_STRIP);
+                    std::fill(strip + p * SPARSE24_STRIP + cols, strip + (p + 1) * SPARSE24_STRIP, 0.0f);
+                }
+                int g0 = pc / 4;
+                int groupNum = (kc + 3) / 4;
+                for (int i = 0; i < m;) {
+                    int rows = m - i >= SPARSE24_MR ? SPARSE24_MR : 1;
+                    const float *values = a.GetValues() + i * valueLd + g0 * 2;
+                    const uint8_t *indices = a.GetIndices() + i * indexLd;
+                    float *tileC = c.data + static_cast<size_t>(i) * n + j;
+                    size_t ldc = n;
+                    if (cols < SPARSE24_STRIP) {
+                        std::fill(edge, edge + rows * SPARSE24_STRIP, 0.0f);
+                        tileC = edge;
+                        ldc = SPARSE24_STRIP;
+                    }
+                    if (rows == SPARSE24_MR) {
+                        Sparse24Tile<SPARSE24_MR>(values, valueLd, indices, indexLd, g0, groupNum, strip, tileC,
+                            ldc);
+                    } else {
+                        Sparse24Tile<1>(values, valueLd, indices, indexLd, g0, groupNum, strip, tileC, ldc);
+                    }
+                    for (int r = 0; tileC == edge && r < rows; r++) {
+                        float *rowC = c.data + static_cast<size_t>(i + r) * n + j;
+                        for (int jj = 0; jj < cols; jj++) {
+                            rowC[jj] += edge[r * SPARSE24_STRIP + jj];
+                        }
+                    }
+                    i += rows;
+                }
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * values[0:NR] = rowA . rowsB[0:NR] over k, NR dot products at once so every vector of rowA is loaded once
+ */
+template <int NR>
+static inline void DotTile(const float *rowA, const float *const *rowsB, int k, float *values)
+{
+    using V = VectorTraits<float>;
+    typename V::Type acc[NR];
+    StaticFor<NR>([&](auto q) { acc[q] = V::Zero(); });
+    int p = 0;
+    for (; p + V::WIDTH <= k; p += V::WIDTH) {
+        typename V::Type vA = V::Load(rowA + p);
+        StaticFor<NR>([&](auto q) { acc[q] = V::MulAdd(acc[q], vA, V::Load(rowsB[q] + p)); });
+    }
+    StaticFor<NR>([&](auto q) {
+        float sum = V::ReduceAdd(acc[q]);
+        for (int pp = p; pp < k; pp++) {
+            sum += rowA[pp] * rowsB[q][pp];
+        }
+        values[q] = sum;
+    });
+}
+
+bool SDDMM(const Matrix &a, const Matrix &b, const CsrMatrix &mask, float *values)
+{
+    if (a.w != b.h || mask.GetHeight() != a.h || mask.GetWidth() != b.w) {
+        LOGE("Cannot sample %dx%d by %dx%d at a %dx%d mask", a.h, a.w, b.h, b.w, mask.GetHeight(), mask.GetWidth());
+        return false;
+    }
+    if (a.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("SDDMM needs a row major a");
+        return false;
+    }
+    int k = a.w;
+    Workspace &workspace = Workspace::GetThreadLocal();
+    Workspace::Scope scope(workspace);
+    // row j of bt is column j of b
+    const float *bt = b.data;
+    if (b.order == MatrixOrder::ROW_MAJOR) {
+        float *transposed = workspace.Alloc<float>(static_cast<size_t>(b.w) * k);
+        Transpose(b.data, b.h, b.w, b.w, transposed, k);
+        bt = transposed;
+    }
+    ThreadPool::GetInstance().ParallelFor(0, mask.GetHeight(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const float *rowA = a.data + static_cast<size_t>(i) * k;
+            int p = mask.GetRowPtr()[i];
+            int last = mask.GetRowPtr()[i + 1];
+            const float *rowsB[SDDMM_NR];
+            for (; p + SDDMM_NR <= last; p += SDDMM_NR) {
+                for (int q = 0; q < SDDMM_NR; q++) {
+                    rowsB[q] = bt + static_cast<size_t>(mask.GetColIdx()[p + q]) * k;
+                }
+                DotTile<SDDMM_NR>(rowA, rowsB, k, values + p);
+            }
+            for (; p < last; p++) {
+                rowsB[0] = bt + static_cast<size_t>(mask.GetColIdx()[p]) * k;
+                DotTile<1>(rowA, rowsB, k, values + p);
+            }
+        }
+    });
+    return true;
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * sparse a: a compressed to CSR, only the nonzeros of a are multiplied, each into a b row held in vector
+ * registers 8 vectors at a time, rows of c split across the thread pool
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Csr(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    TIMEPERF(Csr);
+    CsrMatrix sparse;
+    {
+        TIMEPERF(ToCsr);
+        sparse = CsrMatrix(a);
+    }
+    SpMM(sparse, b, c);
+}
+
+/**
+ * matrix multiplication
+ * i for c height, j for c width, k for a width
+ * block sparse a: a compressed to 4x4 BSR blocks, only the nonzero blocks are multiplied with a 4x2 vector
+ * register tile of c, block rows of c split across the thread pool
+ *
+ * @param a The first input matrix
+ * @param b The second input matrix
+ * @param c The output matrix to store the result
+ *
+ * @return void
+ *
+ * @throws None
+ */
+void GeMM::Bsr(Matrix &a, Matrix &b, Matrix &c)
+{
+    if (!CheckParam(a, b, c)) {
+        return;
+    }
+    TIMEPERF(Bsr);
+    BsrMatrix sparse;
+    {
+        TIMEPERF(ToBsr);
+        sparse = BsrMatrix(a);
+    }
+    SpMM(sparse, b, c);
+}
+
+REGISTER_KERNEL(Csr, KernelInfo("Csr", "CSR sparse a, b rows in vector registers, multi-thread", GeMM::Csr)
+                         .Vector(SIMD_WIDTH)
+                         .Parallel()
+                         .Manual());
+REGISTER_KERNEL(Bsr, KernelInfo("Bsr", "4x4 block sparse a, 4x2 vector register tile, multi-thread", GeMM::Bsr)
+                         .Vector(SIMD_WIDTH)
+                         .Parallel()
+                         .Manual());
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include "ThreadPool.h"
+#include "log.h"
+#include "allocator.h"
+#include "micro_kernel.h"
+#include "transpose.h"
+
+/**
+ * the 4x4 tile at src with row stride lds transposed into dst with row stride ldd
+ */
+static inline void Transpose4x4(const float *src, size_t lds, float *dst, size_t ldd)
+{
+#ifdef __ARM_NEON
+    float32x4x2_t t01 = vtrnq_f32(vld1q_f32(src), vld1q_f32(src + lds));
+    float32x4x2_t t23 = vtrnq_f32(vld1q_f32(src + 2 * lds), vld1q_f32(src + 3 * lds));
+    vst1q_f32(dst, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+    vst1q_f32(dst + ldd, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+    vst1q_f32(dst + 2 * ldd, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+    vst1q_f32(dst + 3 * ldd, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+#elif defined(__SSE2__)
+    __m128 r0 = _mm_loadu_ps(src);
+    __m128 r1 = _mm_loadu_ps(src + lds);
+    __m128 r2 = _mm_loadu_ps(src + 2 * lds);
+    __m128 r3 = _mm_loadu_ps(src + 3 * lds);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(dst, r0);
+    _mm_storeu_ps(dst + ldd, r1);
+    _mm_storeu_ps(dst + 2 * ldd, r2);
+    _mm_storeu_ps(dst + 3 * ldd, r3);
+#else
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+#endif
+}
+
+/**
+ * the rows x cols block at src transposed into dst, 4x4 tiles in registers and single elements at the edges
+ */
+static void TransposeBlock(const float *src, int rows, int cols, size_t lds, float *dst, size_t ldd)
+{
+    int rowsMain = rows / 4 * 4;
+    int colsMain = cols / 4 * 4;
+    for (int i = 0; i < rowsMain; i += 4) {
+        for (int j = 0; j < colsMain; j += 4) {
+            Transpose4x4(src + i * lds + j, lds, dst + j * ldd + i, ldd);
+        }
+    }
+    for (int i = 0; i < rows; i++) {
+        for (int j = i < rowsMain ? colsMain : 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+/**
+ * dst[0:len] = src[0:len], with non-temporal stores when stream is set: a transposed row is not read again soon
+ * and streaming it skips the read for ownership of every destination line. only whole cache lines may be streamed,
+ * a partially written line is flushed by the write combining buffers as several slow partial writes, so with
+ * stream set dst must start on a cache line and len must be a multiple of CACHE_LINE_FLOATS
+ */
+static inline void CopyRow(const float *src, int len, float *dst, bool stream)
+{
+    using V = VectorTraits<float>;
+    int j = 0;
+    if (stream) {
+        for (; j + V::WIDTH <= len; j += V::WIDTH) {
+            V::StoreStream(dst + j, V::Load(src + j));
+        }
+        return;
+    }
+    for (; j + V::WIDTH <= len; j += V::WIDTH) {
+        V::Store(dst + j, V::Load(src + j));
+    }
+    for (; j < len; j++) {
+        dst[j] = src[j];
+    }
+}
+
+void Transpose(const float *src, int h, int w, size_t lds, float *dst, size_t ldd)
+{
+    int blockRows = (h + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    // the runs of a block row start TRANSPOSE_BLOCK floats apart, so they all start on a cache line when dst and
+    // every destination row do
+    bool stream = ldd * sizeof(float) % CACHE_LINE_BYTES == 0 &&
+                  reinterpret_cast<uintptr_t>(dst) % CACHE_LINE_BYTES == 0;
+    ThreadPool::GetInstance().ParallelFor(0, blockRows, [&](int begin, int end) {
+        // a block goes through a dense scratch block so that each destination row is written as one contiguous
+        // run, with power of two strides the destination rows of a block share a cache set and 4x4 tiles written
+        // straight into them would evict each other
+        alignas(CACHE_LINE_BYTES) float block[TRANSPOSE_BLOCK * TRANSPOSE_BLOCK];
+        for (int bi = begin; bi < end; bi++) {
+            int i = bi * TRANSPOSE_BLOCK;
+            int rows = std::min(TRANSPOSE_BLOCK, h - i);
+            bool streamRows = stream && rows % CACHE_LINE_FLOATS == 0;
+            for (int j = 0; j < w; j += TRANSPOSE_BLOCK) {
+                int cols = std::min(TRANSPOSE_BLOCK, w - j);
+                TransposeBlock(src + i * lds + j, rows, cols, lds, block, TRANSPOSE_BLOCK);
+                for (int jj = 0; jj < cols; jj++) {
+                    CopyRow(block + jj * TRANSPOSE_BLOCK, rows, dst + (j + jj) * ldd + i, streamRows);
+                }
+            }
+        }
+        if (stream) {
+            StreamFence();
+        }
+    });
+}
+
+void Transpose(const Matrix &src, Matrix &dst)
+{
+    if (src.h != dst.w || src.w != dst.h) {
+        LOGE("Cannot transpose %dx%d into %dx%d", src.h, src.w, dst.h, dst.w);
+        return;
+    }
+    if (src.order != MatrixOrder::ROW_MAJOR || dst.order != MatrixOrder::ROW_MAJOR) {
+        LOGE("Transpose needs row major matrices");
+        return;
+    }
+    Transpose(src.data, src.h, src.w, src.w, dst.data, dst.w);
+}
+
+/**
+ * swap the 4x4 tiles at x and y transposed, x == y transposes a diagonal tile
+ */
+static inline void SwapTranspose4x4(float *x, float *y, size_t ld)
+{
+    float tileX[16];
+    float tileY[16];
+    Transpose4x4(x, ld, tileX, 4);
+    Transpose4x4(y, ld, tileY, 4);
+    for (int i = 0; i < 4; i++) {
+        std::copy(tileY + i * 4, tileY + i * 4 + 4, x + i * ld);
+        std::copy(tileX + i * 4, tileX + i * 4 + 4, y + i * ld);
+    }
+}
+
+void TransposeInPlace(float *data, int n, size_t ld)
+{
+    int nMain = n / 4 * 4;
+    int blockNum = (nMain + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    // block row bi swaps its blocks right of the diagonal with block column bi below the diagonal
+    ThreadPool::GetInstance().ParallelFor(0, blockNum, [&](int begin, int end) {
+        for (int bi = begin; bi < end; bi++) {
+            int iBegin = bi * TRANSPOSE_BLOCK;
+            int iEnd = std::min(iBegin + TRANSPOSE_BLOCK, nMain);
+            for (int j = iBegin; j < nMain; j += TRANSPOSE_BLOCK) {
+                int jEnd = std::min(j + TRANSPOSE_BLOCK, nMain);
+                for (int i = iBegin; i < iEnd; i += 4) {
+                    for (int jj = std::max(j, i); jj < jEnd; jj += 4) {
+                        SwapTranspose4x4(data + i * ld + jj, data + jj * ld + i, ld);
+                    }
+                }
+            }
+        }
+    });
+    for (int i = 0; i < n; i++) {
+        for (int j = std::max(i + 1, nMain); j < n; j++) {
+            std::swap(data[i * ld + j], data[j * ld + i]);
+        }
+    }
+}
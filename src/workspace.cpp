@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include "log.h"
+#include "workspace.h"
+
+static std::atomic<size_t> g_peakHighWater{0};
+static std::atomic<long> g_heapAllocNum{0};
+
+static size_t AlignUp(size_t bytes)
+{
+    return (bytes + CACHE_LINE_BYTES - 1) & ~(CACHE_LINE_BYTES - 1);
+}
+
+Workspace &Workspace::GetThreadLocal()
+{
+    static thread_local Workspace workspace;
+    return workspace;
+}
+
+size_t Workspace::GetPeakHighWater()
+{
+    return g_peakHighWater;
+}
+
+long Workspace::GetHeapAllocNum()
+{
+    return g_heapAllocNum;
+}
+
+void *Workspace::AllocBytes(size_t bytes)
+{
+    bytes = AlignUp(bytes);
+    void *ptr = nullptr;
+    if (m_offset + bytes <= m_block.size()) {
+        ptr = m_block.data() + m_offset;
+        m_offset += bytes;
+    } else {
+        m_overflow.emplace_back(bytes);
+        m_overflowBytes += bytes;
+        g_heapAllocNum++;
+        ptr = m_overflow.back().data();
+    }
+    m_highWater = std::max(m_highWater, m_offset + m_overflowBytes);
+    size_t peak = g_peakHighWater;
+    while (peak < m_highWater && !g_peakHighWater.compare_exchange_weak(peak, m_highWater)) {
+    }
+    return ptr;
+}
+
+void Workspace::Release(size_t offset)
+{
+    m_offset = offset;
+    if (--m_depth > 0 || m_overflow.empty() || m_offset != 0) {
+        return;
+    }
+    // grow to everything the last scopes needed at once, touching every page now instead of inside a kernel
+    m_overflow.clear();
+    m_overflowBytes = 0;
+    m_block = Buffer<char>(m_highWater);
+    g_heapAllocNum++;
+    if (!m_block.data()) {
+        LOGE("Failed to grow the workspace to %zu bytes", m_highWater);
+        return;
+    }
+    memset(m_block.data(), 0, m_block.size());
+}